@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <opencv2/imgproc.hpp>
+#include <rerun.hpp>
+#include <string>
+#include <vector>
+
+#include "backprojection.hpp"
+#include "matrix_helpers.hpp"
+#include "rerun_helpers.hpp"
+#include "voxel_grid.hpp"
+
+/** Per-call heap allocations and latency of the Rerun logging helpers.
+ *
+ * Every `operator new` in the process is counted.  Each case is called once
+ * before measuring, so first-use costs (interning a path, sizing a reusable
+ * buffer) are excluded.
+ *
+ * Against a disabled stream, a helper must return before doing any work, so
+ * every case must make zero allocations.
+ *
+ * Against an enabled stream recording to /dev/null, the SDK allocates while
+ * serializing archetypes (e.g. the `std::string` inside every `TextLog`).
+ * Each helper is compared with a baseline that makes the same SDK and
+ * library calls directly on prepared inputs, and must not allocate more.
+ * Baselines that use OpenCV's thread pool vary slightly between runs, so
+ * half an allocation per call is tolerated; an extra allocation per call in
+ * a helper still fails.
+ */
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size > 0 ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+/* Allocations per call a helper may exceed its baseline by */
+#define BENCH_BASELINE_SLACK 0.5
+
+/* Run `fn` `iterations` times and return the allocations made per call.
+ * Results go to stderr, as the helpers echo text to stdout.
+ */
+template <typename F>
+static double measure(const char* name, int iterations, F&& fn) {
+    fn();
+    size_t before = allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t count = allocations.load(std::memory_order_relaxed) - before;
+    double per_call = (double)count / iterations;
+    fprintf(
+        stderr,
+        "%-32s %12.1f ns/call %8.2f allocs/call\n",
+        name,
+        (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count() /
+            iterations,
+        per_call
+    );
+    return per_call;
+}
+
+/* Measure `helper` and `baseline`; true if the helper allocates more */
+template <typename H, typename B>
+static bool exceeds_baseline(
+    const char* name, int iterations, H&& helper, B&& baseline
+) {
+    double helper_allocs = measure(name, iterations, helper);
+    double baseline_allocs = measure("  baseline", iterations, baseline);
+    return helper_allocs > baseline_allocs + BENCH_BASELINE_SLACK;
+}
+
+/* Baseline of `log_points`: positions borrowed, colors converted once */
+static void sdk_points(
+    const rerun::RecordingStream& rec,
+    std::string_view path,
+    const std::vector<cv::Point3f>& points,
+    const std::vector<rerun::Color>& colors,
+    rerun::components::Radius radius
+) {
+    rec.log(
+        path,
+        rerun::Points3D(
+            rerun::Collection<rerun::Position3D>::borrow(
+                reinterpret_cast<const rerun::Position3D*>(points.data()),
+                points.size()
+            )
+        )
+            .with_colors(colors)
+            .with_radii(radius)
+    );
+}
+
+static void sdk_image(
+    const rerun::RecordingStream& rec, std::string_view path, const cv::Mat& img
+) {
+    rec.log(
+        path,
+        rerun::Image(
+            rerun::borrow(img.data, img.total() * img.elemSize()),
+            rerun::WidthHeight(
+                static_cast<uint32_t>(img.cols), static_cast<uint32_t>(img.rows)
+            ),
+            rerun::ColorModel::BGR
+        )
+    );
+}
+
+static void sdk_text(
+    const rerun::RecordingStream& rec,
+    std::string_view path,
+    const std::string& text
+) {
+    rec.log(path, rerun::TextLog(text).with_level(TextLogLevel::Info));
+}
+
+static void sdk_transform(
+    const rerun::RecordingStream& rec, std::string_view path, float scale
+) {
+    rec.log(
+        path,
+        rerun::Transform3D::from_translation_mat3x3(
+            rerun::components::Translation3D(0.0f, 0.0f, 0.0f),
+            rerun::datatypes::Mat3x3({
+                rerun::Vec3D(1.0f, 0.0f, 0.0f),
+                rerun::Vec3D(0.0f, 1.0f, 0.0f),
+                rerun::Vec3D(0.0f, 0.0f, 1.0f),
+            })
+        )
+            .with_scale(rerun::Vec3D(scale, scale, scale))
+    );
+}
+
+static void sdk_axis(const rerun::RecordingStream& rec, std::string_view path) {
+    static const std::array<rerun::Vec3D, 3> vecs = {{
+        {1.0f, 0.0f, 0.0f},
+        {0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f},
+    }};
+    static const std::array<rerun::Position3D, 3> origins = {{
+        {0.0f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f},
+    }};
+    static const std::array<rerun::Color, 3> colors = {
+        rerun::Color(255, 0, 0, 255),
+        rerun::Color(0, 255, 0, 255),
+        rerun::Color(0, 0, 255, 255),
+    };
+    rec.log(
+        path,
+        rerun::Arrows3D::from_vectors(vecs).with_origins(origins).with_colors(
+            colors
+        )
+    );
+}
+
+static void sdk_tensor(
+    const rerun::RecordingStream& rec, std::string_view path
+) {
+    rec.log(
+        path,
+        rerun::Tensor().with_data(
+            rerun::TensorData({3, 1}, std::array<float, 3>{0.1f, 0.2f, 0.3f})
+        )
+    );
+}
+
+/* Inputs shared by the helper calls and their baselines */
+struct BenchData {
+    cv::Matx44f transform;
+    std::vector<cv::Point3f> points;
+    std::vector<cv::Vec3b> colors;
+    std::vector<rerun::Color> rr_colors;
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat image;
+    cv::Mat gray;
+    cv::Mat depth;
+    cv::Matx31d rvec;
+    cv::Matx31d tvec;
+    cv::Matx33d camera_matrix;
+    PointLod lod;
+    /* LOD level paths, which the helpers build per call */
+    std::vector<std::string> lod_paths;
+    /* Scratch for baselines, reused like the helpers' own */
+    std::vector<cv::Point3f> level_points;
+    std::vector<cv::Vec3b> level_colors;
+    std::vector<rerun::Color> level_rr_colors;
+    cv::Mat draw;
+    RayTable rays;
+    std::vector<cv::Point3f> cloud;
+    std::vector<cv::Vec3b> cloud_colors;
+    std::vector<rerun::Color> cloud_rr_colors;
+};
+
+/* BGR to the SDK's RGBA, into `out` */
+static void to_rr_colors(
+    const std::vector<cv::Vec3b>& colors, std::vector<rerun::Color>& out
+) {
+    out.clear();
+    for (const cv::Vec3b& bgr : colors) {
+        out.emplace_back(bgr[2], bgr[1], bgr[0], 255);
+    }
+}
+
+/* Baseline of `rr_log_points3d` with colors and a LOD */
+static void sdk_point_lod(
+    const rerun::RecordingStream& rec,
+    BenchData& d,
+    const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>& colors,
+    const std::vector<rerun::Color>& rr_colors
+) {
+    for (size_t i = 0; i < d.lod.voxel_sizes.size(); ++i) {
+        float size = d.lod.voxel_sizes[i];
+        if (size <= 0.0f) {
+            sdk_points(
+                rec,
+                d.lod_paths[i],
+                points,
+                rr_colors,
+                rerun::components::Radius::ui_points(1.0f)
+            );
+            continue;
+        }
+        voxel_downsample(
+            points, &colors, size, d.lod.mode, d.level_points, &d.level_colors
+        );
+        to_rr_colors(d.level_colors, d.level_rr_colors);
+        sdk_points(
+            rec,
+            d.lod_paths[i],
+            d.level_points,
+            d.level_rr_colors,
+            rerun::components::Radius(0.5f * size)
+        );
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    /* Cases that move whole frames or clouds through the SDK */
+    int frame_iterations = std::max(10, iterations / 100);
+    /* Helpers echo text to the console; keep it out of the results */
+    if (freopen("/dev/null", "w", stdout) == nullptr) {
+        fprintf(stderr, "Failed to silence stdout\n");
+    }
+
+    rerun::set_default_enabled(false);
+    const auto rec_off = rerun::RecordingStream("rerun_helpers_bench");
+    rerun::set_default_enabled(true);
+    const auto rec = rerun::RecordingStream("rerun_helpers_bench");
+    if (rec.save("/dev/null").is_err()) {
+        fprintf(stderr, "Failed to record to /dev/null\n");
+        return EXIT_FAILURE;
+    }
+
+    const RrPath root = rr_path("bench");
+    const RrPath points_path = rr_path_child(root, "points");
+    BenchData d = {};
+    d.transform = cv::Matx44f::eye();
+    d.points.assign(1024, cv::Point3f(1.0f, 2.0f, 3.0f));
+    d.colors.assign(d.points.size(), cv::Vec3b(0, 128, 255));
+    to_rr_colors(d.colors, d.rr_colors);
+    d.keypoints.resize(64);
+    d.image = cv::Mat(480, 640, CV_8UC3, cv::Scalar(0, 0, 0));
+    d.gray = cv::Mat(480, 640, CV_8UC1, cv::Scalar(0));
+    d.depth = cv::Mat(480, 640, CV_32FC1, cv::Scalar(1.0));
+    d.rvec = cv::Matx31d(0.1, 0.2, 0.3);
+    d.tvec = cv::Matx31d(1.0, 2.0, 3.0);
+    d.camera_matrix = cv::Matx33d(500, 0, 320, 0, 500, 240, 0, 0, 1);
+    d.lod = {{0.0f, 0.1f, 1.0f}, VOXEL_CENTROID};
+    for (size_t i = 0; i < d.lod.voxel_sizes.size(); ++i) {
+        d.lod_paths.push_back(
+            std::string(points_path) + "/lod" + std::to_string(i)
+        );
+    }
+    const std::string text = "curr_rvec = [0.1, 0.2, 0.3]";
+
+    /* Helper-side bookkeeping */
+    auto intern = [&] { rr_path("bench/pose_estimate/image"); };
+    auto intern_child = [&] { rr_path_child(root, "pose_estimate"); };
+    auto format = [&] {
+        rr_format("curr_rvec = [%g, %g, %g]", 0.1, 0.2, 0.3);
+    };
+
+    /* Full calls, parameterized on the stream */
+    auto log_text = [&](const rerun::RecordingStream& r) {
+        rr_log_text(root, text, r);
+    };
+    auto transform3d = [&](const rerun::RecordingStream& r) {
+        rr_log_transform3d(root, d.transform, {1.0f, 1.0f, 1.0f}, r);
+    };
+    auto axis_system = [&](const rerun::RecordingStream& r) {
+        rr_log_axis_system(root, 1.0f, r);
+    };
+    auto points3d = [&](const rerun::RecordingStream& r) {
+        rr_log_points3d(points_path, d.points, d.colors, r);
+    };
+    auto points3d_lod = [&](const rerun::RecordingStream& r) {
+        rr_log_points3d(points_path, d.points, d.colors, r, &d.lod);
+    };
+    auto mat_image = [&](const rerun::RecordingStream& r) {
+        rr_log_mat_image(root, d.image, rerun::ColorModel::BGR, r);
+    };
+    auto mat_image_tag = [&](const rerun::RecordingStream& r) {
+        rr_log_mat_image(root, d.image, rerun::ColorModel::BGR, r, "tag");
+    };
+    auto mat_image_if_changed = [&](const rerun::RecordingStream& r) {
+        rr_log_mat_image_if_changed(root, d.image, rerun::ColorModel::BGR, r);
+    };
+    auto keypoints_image = [&](const rerun::RecordingStream& r) {
+        rr_log_keypoints_image(root, d.keypoints, d.gray, r);
+    };
+    auto pose_estimation = [&](const rerun::RecordingStream& r) {
+        rr_log_pose_estimation(
+            root,
+            d.image,
+            d.rvec,
+            d.tvec,
+            d.camera_matrix,
+            r,
+            d.depth,
+            1,
+            &d.lod
+        );
+    };
+
+    /* The same SDK and library calls, made directly */
+    auto base_text = [&] { sdk_text(rec, root, text); };
+    auto base_transform3d = [&] { sdk_transform(rec, root, 1.0f); };
+    auto base_axis_system = [&] { sdk_axis(rec, root); };
+    auto base_points3d = [&] {
+        sdk_points(
+            rec,
+            points_path,
+            d.points,
+            d.rr_colors,
+            rerun::components::Radius::ui_points(1.0f)
+        );
+    };
+    auto base_points3d_lod = [&] {
+        sdk_point_lod(rec, d, d.points, d.colors, d.rr_colors);
+    };
+    auto base_mat_image = [&] { sdk_image(rec, root, d.image); };
+    auto base_mat_image_tag = [&] {
+        d.image.copyTo(d.draw);
+        cv::putText(
+            d.draw, "tag", {10, 10}, cv::FONT_HERSHEY_SIMPLEX, 1, {0, 255, 0}
+        );
+        sdk_image(rec, root, d.draw);
+    };
+    /* The frame never changes, so nothing is logged after the first call */
+    auto base_mat_image_if_changed = [&] {};
+    auto base_keypoints_image = [&] {
+        cv::cvtColor(d.gray, d.draw, cv::COLOR_GRAY2BGR);
+        cv::drawKeypoints(d.draw, d.keypoints, d.draw);
+        sdk_image(rec, root, d.draw);
+    };
+    auto base_pose_estimation = [&] {
+        sdk_text(rec, "bench/pose_estimate", text);
+        sdk_tensor(rec, "bench/pose_estimate/pose_vecs/rvec");
+        sdk_text(rec, "bench/pose_estimate", text);
+        sdk_tensor(rec, "bench/pose_estimate/pose_vecs/tvec");
+        sdk_text(rec, "bench/pose_estimate/calibration", text);
+        cv::Matx44f transform =
+            transform_from_translation_rotation_rodrigues(d.tvec, d.rvec);
+        transform = transform.inv();
+        sdk_axis(rec, "bench/pose_estimate/axis");
+        sdk_transform(rec, "bench/pose_estimate/axis", 10.0f);
+        sdk_image(rec, "bench/pose_estimate/image", d.image);
+        if (!RayTable_Matches(
+                d.rays, d.camera_matrix, d.depth.cols, d.depth.rows, 1
+            )) {
+            RayTable_Init(
+                &d.rays, d.camera_matrix, d.depth.cols, d.depth.rows, 1
+            );
+        }
+        backproject_depth(
+            d.rays, d.depth, d.rvec, d.tvec, d.cloud, d.image, &d.cloud_colors
+        );
+        to_rr_colors(d.cloud_colors, d.cloud_rr_colors);
+        sdk_point_lod(rec, d, d.cloud, d.cloud_colors, d.cloud_rr_colors);
+        sdk_transform(rec, "bench/pose_estimate/points", 1.0f);
+        rec.log(
+            "bench/pose_estimate/image",
+            rerun::Pinhole::from_focal_length_and_resolution(
+                rerun::Vec2D{500.0f, 500.0f}, rerun::Vec2D{640.0f, 480.0f}
+            )
+                .with_camera_xyz(rerun::components::ViewCoordinates::RDF)
+                .with_many_image_plane_distance(
+                    rerun::components::ImagePlaneDistance(1.0f)
+                )
+        );
+        sdk_transform(rec, "bench/pose_estimate/image", 1.0f);
+    };
+
+    /* A helper must not allocate at all on the disabled stream */
+    auto disabled = [&](const char* name, auto&& fn) {
+        return measure(name, iterations, [&] { fn(rec_off); }) != 0.0;
+    };
+    /* Nor more than its baseline on the enabled one */
+    auto enabled = [&](const char* name, int n, auto&& fn, auto&& baseline) {
+        return exceeds_baseline(name, n, [&] { fn(rec); }, baseline);
+    };
+
+    int failures = 0;
+    fprintf(stderr, "Disabled stream: no allocations\n");
+    failures += measure("rr_path", iterations, intern) != 0.0;
+    failures += measure("rr_path_child", iterations, intern_child) != 0.0;
+    failures += measure("rr_format", iterations, format) != 0.0;
+    failures += disabled("rr_log_text", log_text);
+    failures += disabled("rr_log_transform3d", transform3d);
+    failures += disabled("rr_log_axis_system", axis_system);
+    failures += disabled("rr_log_points3d", points3d);
+    failures += disabled("rr_log_points3d (lod)", points3d_lod);
+    failures += disabled("rr_log_mat_image", mat_image);
+    failures += disabled("rr_log_mat_image (tag)", mat_image_tag);
+    failures += disabled("rr_log_mat_image_if_changed", mat_image_if_changed);
+    failures += disabled("rr_log_keypoints_image", keypoints_image);
+    failures += disabled("rr_log_pose_estimation", pose_estimation);
+
+    fprintf(stderr, "Enabled stream: no allocations beyond the baseline\n");
+    const int n = iterations;
+    const int frames = frame_iterations;
+    failures += enabled("rr_log_text", n, log_text, base_text);
+    failures +=
+        enabled("rr_log_transform3d", n, transform3d, base_transform3d);
+    failures +=
+        enabled("rr_log_axis_system", n, axis_system, base_axis_system);
+    failures += enabled("rr_log_points3d", n, points3d, base_points3d);
+    failures += enabled(
+        "rr_log_points3d (lod)", frames, points3d_lod, base_points3d_lod
+    );
+    failures += enabled("rr_log_mat_image", frames, mat_image, base_mat_image);
+    failures += enabled(
+        "rr_log_mat_image (tag)", frames, mat_image_tag, base_mat_image_tag
+    );
+    failures += enabled(
+        "rr_log_mat_image_if_changed",
+        frames,
+        mat_image_if_changed,
+        base_mat_image_if_changed
+    );
+    failures += enabled(
+        "rr_log_keypoints_image", frames, keypoints_image, base_keypoints_image
+    );
+    failures += enabled(
+        "rr_log_pose_estimation", frames, pose_estimation, base_pose_estimation
+    );
+
+    if (failures > 0) {
+        fprintf(stderr, "%d helper stage(s) allocated per call\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
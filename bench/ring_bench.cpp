@@ -0,0 +1,184 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "ring.hpp"
+
+/** Throughput and delivery check for both ring policies.
+ *
+ * Producers push tagged sequence numbers and consumers record every value
+ * they pop.  The run fails unless each value arrives exactly once and, per
+ * producer, in the order it was pushed.
+ */
+
+#define RING_BENCH_CAPACITY 1024
+
+/* Value for producer `producer`'s `i`th push */
+static inline uint64_t ring_value(uint32_t producer, uint64_t i) {
+    return ((uint64_t)producer << 40) | i;
+}
+
+/* Check that every producer's values arrived once each, in order per
+ * consumer
+ */
+static bool check_delivery(
+    const std::vector<std::vector<uint64_t>>& popped,
+    uint32_t n_producers,
+    uint64_t per_producer
+) {
+    std::vector<uint8_t> seen((size_t)n_producers * per_producer, 0);
+    for (const std::vector<uint64_t>& values : popped) {
+        std::vector<int64_t> last(n_producers, -1);
+        for (uint64_t value : values) {
+            uint32_t producer = (uint32_t)(value >> 40);
+            int64_t i = (int64_t)(value & ((1ULL << 40) - 1));
+            if (producer >= n_producers || (uint64_t)i >= per_producer) {
+                fprintf(
+                    stderr,
+                    "Unexpected value %#llx\n",
+                    (unsigned long long)value
+                );
+                return false;
+            }
+            if (i <= last[producer]) {
+                fprintf(
+                    stderr,
+                    "Producer %u reordered at %lld\n",
+                    producer,
+                    (long long)i
+                );
+                return false;
+            }
+            last[producer] = i;
+            seen[(size_t)producer * per_producer + i] += 1;
+        }
+    }
+    for (size_t i = 0; i < seen.size(); ++i) {
+        if (seen[i] != 1) {
+            fprintf(
+                stderr,
+                "Value %zu of producer %zu popped %u times\n",
+                i % per_producer,
+                i / per_producer,
+                seen[i]
+            );
+            return false;
+        }
+    }
+    return true;
+}
+
+static void report(
+    const char* name,
+    uint64_t items,
+    std::chrono::steady_clock::duration elapsed
+) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    printf(
+        "%-28s %10.1f ns/item %8.2f Mitems/s\n",
+        name,
+        seconds * 1e9 / items,
+        items / seconds / 1e6
+    );
+}
+
+static bool run_spsc(uint64_t items) {
+    Ring<uint64_t, SpscPolicy> ring(RING_BENCH_CAPACITY);
+    std::vector<std::vector<uint64_t>> popped(1);
+    popped[0].reserve(items);
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < items; ++i) {
+            uint64_t* slot;
+            while ((slot = ring.claim()) == nullptr) {
+                std::this_thread::yield();
+            }
+            *slot = ring_value(0, i);
+            ring.publish();
+        }
+    });
+    while (popped[0].size() < items) {
+        uint64_t* value = ring.front();
+        if (value == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        popped[0].push_back(*value);
+        ring.pop();
+    }
+    producer.join();
+    report("spsc 1x1", items, std::chrono::steady_clock::now() - start);
+    return check_delivery(popped, 1, items);
+}
+
+static bool run_mpmc(
+    uint32_t n_producers, uint32_t n_consumers, uint64_t per_producer
+) {
+    Ring<uint64_t, MpmcPolicy> ring(RING_BENCH_CAPACITY);
+    const uint64_t items = per_producer * n_producers;
+    std::atomic<uint64_t> popped_count{0};
+    std::vector<std::vector<uint64_t>> popped(n_consumers);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t p = 0; p < n_producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (uint64_t i = 0; i < per_producer; ++i) {
+                while (!ring.try_push(ring_value(p, i))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (uint32_t c = 0; c < n_consumers; ++c) {
+        threads.emplace_back([&, c] {
+            uint64_t value;
+            while (popped_count.load(std::memory_order_relaxed) < items) {
+                if (!ring.try_pop(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                popped[c].push_back(value);
+                popped_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "mpmc %ux%u", n_producers, n_consumers);
+    report(name, items, std::chrono::steady_clock::now() - start);
+    return check_delivery(popped, n_producers, per_producer) &&
+           ring.empty();
+}
+
+int main(int argc, char** argv) {
+    long long items = argc > 1 ? atoll(argv[1]) : 1000000;
+    if (items <= 0) {
+        fprintf(stderr, "Usage: %s [items]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int failures = 0;
+    failures += !run_spsc(items);
+    failures += !run_mpmc(1, 1, items);
+    failures += !run_mpmc(4, 1, items / 4);
+    failures += !run_mpmc(1, 4, items);
+    failures += !run_mpmc(4, 4, items / 4);
+
+    if (failures > 0) {
+        fprintf(
+            stderr,
+            "%d ring case(s) lost, duplicated or reordered values\n",
+            failures
+        );
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#ifndef BACKPROJECTION_HPP
+#define BACKPROJECTION_HPP
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "status.hpp"
+
+/** Camera rays for a fixed intrinsic matrix, resolution and sampling stride.
+ *
+ * Each sample stores the normalized image coordinates `((u - cx) / fx,
+ * (v - cy) / fy)` of its pixel, i.e. the camera-frame ray through it at unit
+ * depth.  Rays are kept as separate x/y arrays so the back-projection loops
+ * stream through contiguous floats.  Build once and reuse for every frame.
+ */
+struct RayTable {
+    cv::Matx33d camera_matrix;
+    int width;
+    int height;
+    int stride;
+    /* Sample grid dimensions: every `stride`-th pixel in each direction */
+    int cols;
+    int rows;
+    std::vector<float> ray_x;
+    std::vector<float> ray_y;
+};
+
+/* Precompute rays for a `width` x `height` image sampled every `stride` px */
+RETURN_STATUS RayTable_Init(
+    RayTable* table,
+    const cv::Matx33d& camera_matrix,
+    int width,
+    int height,
+    int stride = 1
+);
+/* Check whether `table` was built for these parameters */
+bool RayTable_Matches(
+    const RayTable& table,
+    const cv::Matx33d& camera_matrix,
+    int width,
+    int height,
+    int stride
+);
+
+/** Back-project sampled pixels into world-frame points.
+ *
+ * `rvec`/`tvec` is the world-to-camera pose (as returned by `cv::solvePnP`).
+ * `depth` is a CV_32FC1 map of camera-frame z, in the same units as `tvec`,
+ * at the table's resolution; samples with non-positive or NaN depth are
+ * skipped.  If `image` (CV_8UC3 BGR or CV_8UC1) is given, the color of each
+ * kept sample is written to `colors` in BGR order; otherwise `colors` is
+ * cleared.  Work is split across OpenCV's thread pool, and each row is
+ * computed with OpenCV's universal intrinsics.
+ */
+RETURN_STATUS backproject_depth(
+    const RayTable& table,
+    const cv::Mat& depth,
+    const cv::Matx31d& rvec,
+    const cv::Matx31d& tvec,
+    std::vector<cv::Point3f>& points,
+    const cv::Mat& image = cv::Mat(),
+    std::vector<cv::Vec3b>* colors = nullptr
+);
+
+/* Back-project every sample onto the camera-frame plane z = `depth` */
+RETURN_STATUS backproject_plane(
+    const RayTable& table,
+    float depth,
+    const cv::Matx31d& rvec,
+    const cv::Matx31d& tvec,
+    std::vector<cv::Point3f>& points,
+    const cv::Mat& image = cv::Mat(),
+    std::vector<cv::Vec3b>* colors = nullptr
+);
+
+#endif /* BACKPROJECTION_HPP */
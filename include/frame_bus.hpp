@@ -0,0 +1,117 @@
+#ifndef FRAME_BUS_HPP
+#define FRAME_BUS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <string>
+
+#include "status.hpp"
+
+/** Shared-memory frame ring for readers in other local processes.
+ *
+ * A single writer process copies frames into a POSIX shared memory segment
+ * (`shm_open`).  Each slot is guarded by a seqlock: the slot sequence is odd
+ * while the writer is copying and is bumped to the next even value once the
+ * frame is complete.  Readers map the segment read-only, keep their own
+ * cursor and read frames in place, re-checking the sequence afterwards to
+ * detect that the writer lapped them mid-read.
+ */
+
+#define FRAME_BUS_MAGIC 0x53554246u /* "FBUS" */
+#define FRAME_BUS_VERSION 1u
+#define FRAME_BUS_ALIGN 64u
+
+struct FrameBusHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+    /* Bytes between consecutive slots, slot header included */
+    uint64_t slot_stride;
+    /* Largest frame payload a slot can hold */
+    uint64_t slot_bytes;
+    /* Number of frames published so far; frame `n` lives in slot
+     * `n % slot_count` */
+    alignas(FRAME_BUS_ALIGN) std::atomic<uint64_t> published;
+};
+
+struct FrameBusSlot {
+    std::atomic<uint64_t> seq;
+    uint64_t frame_idx;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint32_t bytes;
+};
+
+static_assert(
+    std::atomic<uint64_t>::is_always_lock_free,
+    "Frame bus requires address-free 64-bit atomics"
+);
+
+/* What a reader does when the writer has overwritten frames it has not read */
+enum FrameBusPolicy {
+    /* Jump to the newest frame, dropping everything in between */
+    FRAME_BUS_SKIP_TO_LATEST,
+    /* Resume at the oldest frame still held in the ring */
+    FRAME_BUS_OLDEST_AVAILABLE,
+};
+
+/* Writer side */
+struct FrameBus {
+    std::string name;
+    int fd;
+    uint8_t* base;
+    size_t map_size;
+    FrameBusHeader* header;
+    /* Serializes in-process writers (loader threads) */
+    std::mutex write_mutex;
+};
+
+/* Reader side */
+struct FrameBusReader {
+    int fd;
+    const uint8_t* base;
+    size_t map_size;
+    const FrameBusHeader* header;
+    FrameBusPolicy policy;
+    /* Index of the next frame this reader will consume */
+    uint64_t cursor;
+    /* Frames skipped or torn because the writer lapped this reader */
+    uint64_t dropped;
+    /* Slot and sequence of the frame currently held by `FrameBus_Acquire` */
+    const FrameBusSlot* held_slot;
+    uint64_t held_seq;
+};
+
+/* Create (or replace) the shared memory segment `name` */
+RETURN_STATUS FrameBus_Create(
+    FrameBus* bus,
+    const std::string& name,
+    uint32_t slot_count,
+    size_t slot_bytes
+);
+/* Copy a frame into the next slot.  Safe to call from several threads. */
+RETURN_STATUS FrameBus_Publish(FrameBus* bus, const cv::Mat& img);
+/* Unmap and unlink the shared memory segment */
+void FrameBus_Destroy(FrameBus* bus);
+
+/* Map an existing segment read-only.  The cursor starts at the newest frame. */
+RETURN_STATUS FrameBus_Open(
+    FrameBusReader* reader, const std::string& name, FrameBusPolicy policy
+);
+/* Point `view` at the next unread frame without copying.  Returns EARLY_OUT
+ * when no new frame has been published.  `view` must not be written to.
+ */
+RETURN_STATUS FrameBus_Acquire(FrameBusReader* reader, cv::Mat& view);
+/* Finish with the frame from `FrameBus_Acquire`.  Returns ERROR if the writer
+ * overwrote it while it was held, in which case its contents must be discarded.
+ */
+RETURN_STATUS FrameBus_Release(FrameBusReader* reader);
+/* Unmap the segment */
+void FrameBus_Close(FrameBusReader* reader);
+
+#endif /* FRAME_BUS_HPP */
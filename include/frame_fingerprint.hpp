@@ -0,0 +1,57 @@
+#ifndef FRAME_FINGERPRINT_HPP
+#define FRAME_FINGERPRINT_HPP
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/* Edge length, in pixels, of the blocks a frame is hashed in */
+#define FINGERPRINT_BLOCK 32
+
+/** Per-block hashes of the last frame seen at some source (e.g. an entity
+ * path).  Comparing a new frame against it finds which blocks changed without
+ * keeping a copy of the previous frame.
+ */
+struct FrameFingerprint {
+    int rows;
+    int cols;
+    int type;
+    int block_size;
+    int blocks_x;
+    int blocks_y;
+    std::vector<uint64_t> block_hashes;
+    /* Reused across frames so hashing a frame does not allocate: per-block
+     * hash state for the block row being hashed, and the previous frame's
+     * hashes during `FrameFingerprint_Update`
+     */
+    std::vector<uint64_t> lanes;
+    std::vector<uint64_t> previous_hashes;
+};
+
+struct FrameChange {
+    /* Every block hashes the same as the previous frame */
+    bool unchanged;
+    /* No previous frame, or its shape/type differs: treat all of it as dirty */
+    bool full;
+    /* Union of the changed blocks */
+    cv::Rect dirty_bounds;
+    /* Changed blocks, clipped to the frame */
+    std::vector<cv::Rect> dirty_blocks;
+    /* Fraction of the frame's blocks that changed */
+    float dirty_fraction;
+};
+
+/* Hash `img` into 64-bit per-block fingerprints */
+void FrameFingerprint_Compute(
+    const cv::Mat& img, int block_size, FrameFingerprint& fp
+);
+/* A change marking all of `img` dirty, e.g. when there was nothing to compare
+ * against
+ */
+FrameChange FrameChange_Full(const cv::Mat& img);
+/* Compare `img` against `fp`, then store `img`'s fingerprint in `fp` */
+FrameChange FrameFingerprint_Update(
+    FrameFingerprint& fp, const cv::Mat& img, int block_size = FINGERPRINT_BLOCK
+);
+
+#endif /* FRAME_FINGERPRINT_HPP */
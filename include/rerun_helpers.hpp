@@ -3,72 +3,215 @@
 
 #include <opencv2/core.hpp>
 #include <rerun.hpp>
+#include <string>
+#include <string_view>
+
+#include "frame_fingerprint.hpp"
+#include "voxel_grid.hpp"
+
+/* SKIP_ALL_LOG compiles every visualization helper down to a no-op and implies
+ * SKIP_IMG_LOG.  Text helpers and `rr_log_pose_estimation` still echo to the
+ * console.
+ */
+#if defined(SKIP_ALL_LOG) && !defined(SKIP_IMG_LOG)
+#define SKIP_IMG_LOG
+#endif
 
 using TextLogLevel = rerun::components::TextLogLevel;
 
+/* Whether logging to `rec` does anything.  Always false with SKIP_ALL_LOG, so
+ * code guarded by it is compiled out.
+ */
+inline bool rr_enabled([[maybe_unused]] const rerun::RecordingStream& rec) {
+#ifdef SKIP_ALL_LOG
+    return false;
+#else
+    return rec.is_enabled();
+#endif
+}
+
+/** Log the archetype returned by `build` only if `rec` is enabled, so the
+ * work of building it is skipped when logging is off, e.g.
+ *
+ *     rr_log_lazy(rec, path, [&] { return rerun::Points3D(make_cloud()); });
+ */
+template <typename Builder>
+inline void rr_log_lazy(
+    const rerun::RecordingStream& rec, std::string_view path, Builder&& build
+) {
+    if (rr_enabled(rec)) {
+        rec.log(path, build());
+    }
+}
+
+/** Interned entity path.
+ *
+ * The path string is stored once for the life of the program, so a handle is a
+ * pointer copy and converts to the `std::string_view` the SDK logs with.
+ * Intern hot paths once and reuse the handle for every call.  Helpers that
+ * only log take `std::string_view`, so they accept handles, `std::string`s and
+ * literals alike, and never intern.  Helpers that keep state per path take a
+ * handle.
+ */
+struct RrPath {
+    const std::string* str;
+    operator std::string_view() const { return *str; }
+};
+
+/* Intern `path`.  Allocates only the first time a path is seen. */
+RrPath rr_path(std::string_view path);
+/* Intern `parent/child` */
+RrPath rr_path_child(RrPath parent, std::string_view child);
+/* printf-style formatting into a per-thread buffer that is reused across
+ * calls.  The result is valid until the next call on the same thread.
+ */
+std::string_view rr_format(const char* fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+void rr_log_text(
+    std::string_view path,
+    std::string_view text,
+    const rerun::RecordingStream& rec,
+    TextLogLevel level = TextLogLevel::Info
+);
+
 void rr_log_message(
-    std::string path,
+    std::string_view path,
     const char* message,
     const rerun::RecordingStream& rec,
     TextLogLevel level = TextLogLevel::Info
 );
 
 void rr_log_stream_and_clear(
-    std::string path,
+    std::string_view path,
     std::stringstream& ss,
     const rerun::RecordingStream& rec,
     TextLogLevel level = TextLogLevel::Info
 );
 
-void rr_log_transform3d(
-    std::string path,
-    cv::Matx44f transform,
-    rerun::Vec3D scale,
-    const rerun::RecordingStream& rec
-);
-
-void rr_log_axis_system(
-    std::string path, float scale, const rerun::RecordingStream& rec
-);
-
 #ifdef SKIP_IMG_LOG
 inline void rr_log_mat_image(
-    [[maybe_unused]] std::string path,
-    [[maybe_unused]] const cv::Mat img,
+    [[maybe_unused]] std::string_view path,
+    [[maybe_unused]] const cv::Mat& img,
     [[maybe_unused]] rerun::ColorModel color_model,
     [[maybe_unused]] const rerun::RecordingStream& rec,
-    [[maybe_unused]] std::string tag = ""
+    [[maybe_unused]] std::string_view tag = {}
 ) {}
+inline FrameChange rr_log_mat_image_if_changed(
+    [[maybe_unused]] RrPath path,
+    const cv::Mat& img,
+    [[maybe_unused]] rerun::ColorModel color_model,
+    [[maybe_unused]] const rerun::RecordingStream& rec
+) {
+    return FrameChange_Full(img);
+}
 #else
 void rr_log_mat_image(
-    std::string path,
-    cv::Mat img,
+    std::string_view path,
+    const cv::Mat& img,
     rerun::ColorModel color_model,
     const rerun::RecordingStream& rec,
-    std::string tag = ""
+    std::string_view tag = {}
+);
+/* Log `img` unless it is identical to the last frame logged through this
+ * function at `path`.  The returned change lists the dirty blocks so callers
+ * can act on just those regions.  Nothing is compared while logging is off,
+ * so the whole frame is reported as changed.
+ */
+FrameChange rr_log_mat_image_if_changed(
+    RrPath path,
+    const cv::Mat& img,
+    rerun::ColorModel color_model,
+    const rerun::RecordingStream& rec
 );
 #endif
+/* Compare `img` with the last frame fingerprinted at `path` and remember it */
+FrameChange rr_image_change(RrPath path, const cv::Mat& img);
+
+#ifdef SKIP_ALL_LOG
+inline void rr_log_transform3d(
+    [[maybe_unused]] std::string_view path,
+    [[maybe_unused]] const cv::Matx44f& transform,
+    [[maybe_unused]] rerun::Vec3D scale,
+    [[maybe_unused]] const rerun::RecordingStream& rec
+) {}
+inline void rr_log_axis_system(
+    [[maybe_unused]] std::string_view path,
+    [[maybe_unused]] float scale,
+    [[maybe_unused]] const rerun::RecordingStream& rec
+) {}
+inline void rr_log_keypoints_image(
+    [[maybe_unused]] std::string_view path,
+    [[maybe_unused]] const std::vector<cv::KeyPoint>& keypoints,
+    [[maybe_unused]] const cv::Mat& image,
+    [[maybe_unused]] const rerun::RecordingStream& rec
+) {}
+inline void rr_log_points3d(
+    [[maybe_unused]] std::string_view path,
+    [[maybe_unused]] const std::vector<cv::Point3f>& points,
+    [[maybe_unused]] const rerun::RecordingStream& rec,
+    [[maybe_unused]] const PointLod* lod = nullptr
+) {}
+inline void rr_log_points3d(
+    [[maybe_unused]] std::string_view path,
+    [[maybe_unused]] const std::vector<cv::Point3f>& points,
+    [[maybe_unused]] const std::vector<cv::Vec3b>& colors,
+    [[maybe_unused]] const rerun::RecordingStream& rec,
+    [[maybe_unused]] const PointLod* lod = nullptr
+) {}
+#else
+void rr_log_transform3d(
+    std::string_view path,
+    const cv::Matx44f& transform,
+    rerun::Vec3D scale,
+    const rerun::RecordingStream& rec
+);
+
+void rr_log_axis_system(
+    std::string_view path, float scale, const rerun::RecordingStream& rec
+);
 
 void rr_log_keypoints_image(
-    std::string path,
-    std::vector<cv::KeyPoint> keypoints,
-    cv::Mat image,
+    std::string_view path,
+    const std::vector<cv::KeyPoint>& keypoints,
+    const cv::Mat& image,
     const rerun::RecordingStream& rec
 );
 
+/* If `lod` is given, the cloud is voxel-downsampled and each level is logged
+ * under `<path>/lod<i>` instead of at `path`.
+ */
 void rr_log_points3d(
-    std::string path,
+    std::string_view path,
     const std::vector<cv::Point3f>& points,
-    const rerun::RecordingStream& rec
+    const rerun::RecordingStream& rec,
+    const PointLod* lod = nullptr
+);
+/* Log points with per-point BGR colors, e.g. from `backproject_depth` */
+void rr_log_points3d(
+    std::string_view path,
+    const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>& colors,
+    const rerun::RecordingStream& rec,
+    const PointLod* lod = nullptr
 );
+#endif
 
+/* If `depth` (CV_32FC1, camera-frame z) is given, every `stride`-th pixel is
+ * back-projected and logged as a colored point cloud, optionally with `lod`.
+ * The pose and camera matrix are echoed to the console even when logging is
+ * off.
+ */
 void rr_log_pose_estimation(
-    std::string path,
-    const cv::Mat image,
+    std::string_view path,
+    const cv::Mat& image,
     const cv::Matx31d& rvec,
     const cv::Matx31d& tvec,
     const cv::Matx33d& camera_matrix,
-    const rerun::RecordingStream& rec
+    const rerun::RecordingStream& rec,
+    const cv::Mat& depth = cv::Mat(),
+    int stride = 1,
+    const PointLod* lod = nullptr
 );
 
 #endif /* RERUN_HELPERS_HPP */
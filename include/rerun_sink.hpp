@@ -0,0 +1,82 @@
+#ifndef RERUN_SINK_HPP
+#define RERUN_SINK_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <rerun.hpp>
+#include <string>
+
+#include "status.hpp"
+
+enum RerunSinkKind {
+    /* Stream to a live viewer over TCP */
+    SINK_VIEWER,
+    /* Record to an .rrd file on local disk */
+    SINK_FILE,
+};
+
+/** Where logs go and how the SDK batches them into chunks.
+ *
+ * Batching thresholds are passed to the SDK through its RERUN_FLUSH_*
+ * environment variables, which it reads when a `RecordingStream` is created.
+ * Negative values keep the SDK defaults.
+ */
+struct RerunSinkConfig {
+    RerunSinkKind kind;
+    /* IP:PORT, for SINK_VIEWER */
+    std::string viewer_addr;
+    /* .rrd path, for SINK_FILE */
+    std::string file_path;
+    /* Flush a chunk once it holds this many bytes */
+    int64_t flush_bytes;
+    /* Flush a chunk once it holds this many rows */
+    int64_t flush_rows;
+    /* Flush pending chunks at least this often */
+    double flush_ms;
+    /* Measure the sink with `RerunSinkStats`.  Forces a flush every window. */
+    bool report_stats;
+};
+
+/* Viewer at 127.0.0.1:9876 with the SDK's batching defaults, no stats */
+RerunSinkConfig RerunSink_Default();
+/* Parse "viewer", "viewer:IP:PORT" or "file:<path>" into `cfg` */
+RETURN_STATUS RerunSink_Parse(const std::string& spec, RerunSinkConfig* cfg);
+/* Export batching thresholds.  Must be called before creating the stream. */
+RETURN_STATUS RerunSink_ApplyBatching(const RerunSinkConfig& cfg);
+/* Connect `rec` to the viewer or start recording it to the file */
+RETURN_STATUS RerunSink_Open(
+    const RerunSinkConfig& cfg, const rerun::RecordingStream& rec
+);
+/* Describe the sink for display, e.g. "file:out.rrd" */
+std::string RerunSink_Describe(const RerunSinkConfig& cfg);
+
+/** Throughput and latency of the sink, reported once per window from the
+ * logging thread when `RerunSinkConfig::report_stats` is set.
+ *
+ * Bytes per second are taken from the growth of the .rrd file (file sinks
+ * only).  Flush latency is how long `flush_blocking` takes at the end of each
+ * window, i.e. how long data already logged takes to reach the sink.  The
+ * window is never shorter than the flush interval, so the forced flush does
+ * not change how the SDK batches.
+ */
+struct RerunSinkStats {
+    RerunSinkKind kind;
+    std::string file_path;
+    std::chrono::steady_clock::duration window;
+    std::chrono::steady_clock::time_point window_start;
+    uintmax_t window_start_bytes;
+    uint64_t log_calls;
+    std::chrono::steady_clock::duration log_time;
+};
+
+void RerunSinkStats_Init(RerunSinkStats* stats, const RerunSinkConfig& cfg);
+/* Account for one logging call (or group of calls) that took `elapsed` */
+void RerunSinkStats_AddLog(
+    RerunSinkStats* stats, std::chrono::steady_clock::duration elapsed
+);
+/* Print and restart the window once it has elapsed */
+void RerunSinkStats_Report(
+    RerunSinkStats* stats, const rerun::RecordingStream& rec
+);
+
+#endif /* RERUN_SINK_HPP */
@@ -0,0 +1,245 @@
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/** Bounded lock-free ring buffers.
+ *
+ * `Ring<T, SpscPolicy>` serves one producer and one consumer (threads may
+ * take turns in either role as long as hand-offs are synchronized, e.g. by a
+ * mutex).  It supports claiming a slot to fill in place and peeking at the
+ * front slot, so large values such as frames are never copied.
+ *
+ * `Ring<T, MpmcPolicy>` serves any number of producers and consumers with
+ * per-slot sequence numbers (Vyukov's bounded queue) and only moves values in
+ * and out.
+ *
+ * Capacity is rounded up to a power of two so slot lookup is a mask rather
+ * than a `%`.  Head and tail live on separate cache lines so producer and
+ * consumer do not false-share.
+ */
+
+#define RING_CACHE_LINE 64
+
+struct SpscPolicy {};
+struct MpmcPolicy {};
+
+inline size_t ring_round_up_pow2(size_t n) {
+    size_t capacity = 1;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+template <typename T, typename Policy = SpscPolicy>
+class Ring;
+
+template <typename T>
+class Ring<T, SpscPolicy> {
+   public:
+    Ring() : mask_(0), head_(0), cached_tail_(0), tail_(0), cached_head_(0) {}
+    explicit Ring(size_t capacity) : Ring() { reset(capacity); }
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    /* Drop all values and resize.  Not safe while other threads use the
+     * ring.
+     */
+    void reset(size_t capacity) {
+        slots_.clear();
+        slots_.resize(ring_round_up_pow2(capacity));
+        mask_ = slots_.size() - 1;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        cached_head_ = 0;
+        cached_tail_ = 0;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+    /* Exact from the producer or consumer thread, approximate elsewhere */
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) -
+               head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= capacity(); }
+
+    /* Producer: slot to fill in place, or nullptr if the ring is full */
+    T* claim() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ >= capacity()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ >= capacity()) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+    /* Producer: make the slot returned by `claim` visible to the consumer */
+    void publish() {
+        tail_.store(
+            tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release
+        );
+    }
+    template <typename U>
+    bool try_push(U&& value) {
+        T* slot = claim();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = std::forward<U>(value);
+        publish();
+        return true;
+    }
+
+    /* Consumer: oldest value, or nullptr if the ring is empty */
+    T* front() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return nullptr;
+            }
+        }
+        return &slots_[head & mask_];
+    }
+    /* Consumer: oldest value without refreshing the consumer's cache, so it
+     * may be called through a const reference by the consuming thread.
+     */
+    const T* front() const {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+    /* Consumer: release the slot returned by `front`.  The value is reset to
+     * `T()` first, so a popped frame does not stay alive in a slot the
+     * producer has yet to reuse.
+     */
+    void pop() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+    }
+    bool try_pop(T& out) {
+        T* slot = front();
+        if (slot == nullptr) {
+            return false;
+        }
+        out = std::move(*slot);
+        pop();
+        return true;
+    }
+
+   private:
+    std::vector<T> slots_;
+    size_t mask_;
+    /* Consumer-owned */
+    alignas(RING_CACHE_LINE) std::atomic<size_t> head_;
+    size_t cached_tail_;
+    /* Producer-owned */
+    alignas(RING_CACHE_LINE) std::atomic<size_t> tail_;
+    size_t cached_head_;
+};
+
+template <typename T>
+class Ring<T, MpmcPolicy> {
+   public:
+    Ring() : mask_(0), capacity_(0), head_(0), tail_(0) {}
+    explicit Ring(size_t capacity) : Ring() { reset(capacity); }
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    /* Drop all values and resize.  Not safe while other threads use the
+     * ring.
+     */
+    void reset(size_t capacity) {
+        capacity_ = ring_round_up_pow2(capacity < 2 ? 2 : capacity);
+        mask_ = capacity_ - 1;
+        cells_.reset(new Cell[capacity_]);
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return capacity_; }
+    /* Approximate under concurrent use */
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t head = head_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= capacity(); }
+
+    template <typename U>
+    bool try_push(U&& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed
+                    )) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::forward<U>(value);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed
+                    )) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->value);
+        cell->seq.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    size_t capacity_;
+    alignas(RING_CACHE_LINE) std::atomic<size_t> head_;
+    alignas(RING_CACHE_LINE) std::atomic<size_t> tail_;
+};
+
+#endif /* RING_HPP */
@@ -0,0 +1,10 @@
+#ifndef STATUS_HPP
+#define STATUS_HPP
+
+enum RETURN_STATUS {
+    OK,
+    ERROR,
+    EARLY_OUT,
+};
+
+#endif /* STATUS_HPP */
@@ -0,0 +1,58 @@
+#ifndef THREAD_CONFIG_HPP
+#define THREAD_CONFIG_HPP
+
+#include <string>
+#include <vector>
+
+#include "status.hpp"
+
+/** Placement and scheduling for pipeline threads.
+ *
+ * Empty CPU sets leave placement to the kernel, within the CPUs the process
+ * was started on; threads created by a pinned thread are released back to
+ * them rather than inheriting its pinning.  When `numa_node` is set, CPU
+ * sets default to (or are restricted to) that node's CPUs.  Loader threads
+ * prefer allocating memory on the consumer's node, so decoded frames are
+ * first touched where they will be read.
+ */
+struct ThreadConfig {
+    std::vector<int> loader_cpus;
+    std::vector<int> consumer_cpus;
+    /* CPUs the process was allowed to run on at startup */
+    std::vector<int> process_cpus;
+    /* -1 for no NUMA binding */
+    int numa_node;
+    /* Nice value for SCHED_OTHER/SCHED_BATCH/SCHED_IDLE threads */
+    int nice;
+    /* SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO or SCHED_RR */
+    int sched_policy;
+    /* Static priority for SCHED_FIFO/SCHED_RR */
+    int sched_priority;
+};
+
+/* Defaults: no pinning, no NUMA binding, SCHED_OTHER at nice 0.  Records the
+ * calling thread's affinity as the process's, so call it before pinning.
+ */
+ThreadConfig ThreadConfig_Default();
+/* Apply NUMA node restrictions to the CPU sets */
+RETURN_STATUS ThreadConfig_Resolve(ThreadConfig& cfg);
+/* Name, pin and schedule the calling thread.  An empty `cpus` restores
+ * `process_cpus`.  `name` is truncated to 15 characters; nullptr keeps the
+ * current name, which for the main thread is the process name.
+ */
+RETURN_STATUS ThreadConfig_Apply(
+    const ThreadConfig& cfg, const char* name, const std::vector<int>& cpus
+);
+/* NUMA node frame memory should live on, or -1 if unknown */
+int ThreadConfig_MemoryNode(const ThreadConfig& cfg);
+/* Prefer allocating the calling thread's new pages on `node` */
+RETURN_STATUS ThreadConfig_PreferNode(int node);
+
+/* Parse "0-3,8,10-11" style CPU lists */
+bool parse_cpu_list(const std::string& list, std::vector<int>& cpus);
+/* Parse "other", "batch", "idle", "fifo" or "rr".  Returns -1 if unknown. */
+int parse_sched_policy(const std::string& policy);
+/* Format a CPU set for display, e.g. "0-3,8" */
+std::string format_cpu_list(const std::vector<int>& cpus);
+
+#endif /* THREAD_CONFIG_HPP */
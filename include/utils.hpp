@@ -4,12 +4,19 @@
 #include <string.h>
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdio>
 #include <filesystem>
+#include <future>
+#include <mutex>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <rerun.hpp>
 #include <rerun_helpers.hpp>
+#include <rerun_sink.hpp>
+#include <ring.hpp>
+#include <status.hpp>
+#include <thread_config.hpp>
 #include <string>
 #include <thread>
 #include <utility>
@@ -21,25 +28,49 @@ namespace fs = std::filesystem;
 std::string build_url(const char* ip_str);
 /* Check for image file types */
 bool is_image_file(const fs::path& img_path);
-/* Load a folder of images into memory */
+
+/* Channel layout and resolution used when decoding image files.  Reduced
+ * decodes map onto `cv::IMREAD_REDUCED_*`, which JPEG performs in the DCT
+ * domain (libjpeg scaling) and other codecs emulate with a post-decode resize.
+ */
+struct DecodeProfile {
+    bool grayscale;
+    /* Downscale factor applied during decode: 1, 2, 4 or 8 */
+    uint32_t reduce;
+};
+inline constexpr DecodeProfile DECODE_COLOR = {false, 1};
+inline constexpr DecodeProfile DECODE_GRAYSCALE = {true, 1};
+
+/* Check that the reduce factor is one `cv::imread` supports */
+bool DecodeProfile_IsValid(const DecodeProfile& profile);
+/* Translate a decode profile into `cv::imread` flags */
+int DecodeProfile_ImreadFlags(const DecodeProfile& profile);
+
+/* Load a folder of images into memory.  Without a `profile`, single files are
+ * decoded grayscale and directories in color.
+ */
 int load_saved_images(
     std::string rr_path,
     const fs::path img_path,
     std::vector<cv::Mat>& images,
-    const rerun::RecordingStream& rec
+    const rerun::RecordingStream& rec,
+    const DecodeProfile* profile = nullptr
 );
 
-enum RETURN_STATUS {
-    OK,
-    ERROR,
-    EARLY_OUT,
-};
+struct FrameBus;
 
 struct Cli {
     std::string path;
     bool enable_rerun;
-    std::string viewer_addr;
+    RerunSinkConfig sink;
     size_t threads;
+    DecodeProfile decode;
+    std::string shm_name;
+    uint32_t shm_slots;
+    uint32_t ready_frames;
+    size_t resident_mb;
+    bool skip_unchanged;
+    ThreadConfig thread_config;
 };
 
 /* Help text for CLI */
@@ -48,32 +79,107 @@ void help();
 std::pair<Cli, RETURN_STATUS> parseArgs(int argc, char** argv);
 
 struct ImageBuffer {
+    /* Every decoded frame in resident mode, otherwise decode staging */
     std::vector<cv::Mat> images;
     std::vector<fs::path> image_paths;
     uint32_t buffer_size;
+    DecodeProfile profile;
+    int imread_flags;
 
-    std::atomic<uint32_t> head_idx;
-    std::atomic<uint32_t> tail_idx;
+    /* Streamed frames, oldest at the front.  Loaders push under
+     * `producer_mutex`; the main loop is the only consumer.  Loaders wait on
+     * `producer_cv` for a free slot.
+     */
+    Ring<cv::Mat, SpscPolicy> ring;
+    std::mutex producer_mutex;
+    std::condition_variable producer_cv;
     std::atomic<uint32_t> path_idx;
+    /* Streaming: loaders claim sequence numbers through `stream_next` and
+     * decode outside the lock into `images[seq % buffer_size]`.
+     * `stream_prefix` is the next sequence number to push, so frames reach
+     * the ring in order.  Guarded by `producer_mutex`.
+     */
+    uint64_t stream_next;
+    uint64_t stream_prefix;
+    std::vector<bool> stream_decoded;
+
+    /* Resident playback position and number of frames decoded so far */
+    std::atomic<uint32_t> head_idx;
     std::atomic<uint32_t> loaded_count;
 
     std::atomic<bool> shutdown;
     std::atomic<uint32_t> loader_threads_count;
     std::vector<std::thread> loader_threads;
-    std::atomic<uint32_t> active_loader_idx;
+    bool has_thread_config;
+    ThreadConfig thread_config;
+
+    /* Initial fill: loaders claim slots through `warm_next` and decode them in
+     * parallel.  `warm_prefix` is the run of decoded slots, starting at 0,
+     * that has been handed to the consumer.  Guarded by `producer_mutex`.
+     */
+    std::atomic<uint32_t> warm_next;
+    std::vector<bool> warm_decoded;
+    uint32_t warm_prefix;
+    std::atomic<bool> warm_complete;
+    std::atomic<uint64_t> warm_decode_us;
+
+    /* Resident mode keeps every decoded image in `images` and replays them by
+     * advancing `head_idx`; loaders exit once the initial decode is done.
+     */
+    size_t resident_budget;
+    bool resident;
+
+    /* Fires once `ready_frames` frames are available to the consumer */
+    uint32_t ready_frames;
+    bool ready_fired;
+    std::promise<void> ready_promise;
+    std::shared_future<void> ready;
+
+    /* Optional shared memory ring that every consumed frame is copied into */
+    std::string bus_name;
+    uint32_t bus_slots;
+    FrameBus* bus;
 };
 
 /* Image loading process */
 void background_image_loader(ImageBuffer* buf, uint32_t loader_idx);
-/* Initialize image buffer */
+/* Initialize image buffer and start filling it in the background.
+ * `ready_frames` of 0 waits for the whole buffer.
+ */
 RETURN_STATUS ImageBuffer_Init(
     ImageBuffer* buffer,
     std::string path,
     uint32_t buffer_size,
-    uint32_t n_loaders
+    uint32_t n_loaders,
+    DecodeProfile profile = DECODE_COLOR,
+    uint32_t ready_frames = 0
+);
+/* Block until the buffer's readiness threshold is reached */
+RETURN_STATUS ImageBuffer_WaitReady(
+    const ImageBuffer& buf, std::chrono::milliseconds timeout
+);
+/* Publish consumed frames to shared memory segment `shm_name`.  Must be called
+ * before `ImageBuffer_Init`.
+ */
+void ImageBuffer_PublishTo(
+    ImageBuffer* buffer, std::string shm_name, uint32_t slot_count
 );
-/* Copy image from at buffer head */
+/* Pin, name and schedule loader threads per `cfg`.  Must be called before
+ * `ImageBuffer_Init`.
+ */
+void ImageBuffer_SetThreadConfig(ImageBuffer* buffer, const ThreadConfig& cfg);
+/* Decode the whole dataset once and replay it from memory if its decoded size
+ * fits in `budget_bytes`.  Must be called before `ImageBuffer_Init`.
+ */
+void ImageBuffer_AllowResident(ImageBuffer* buffer, size_t budget_bytes);
+/* Copy image at buffer head into `img`, which must have the same shape.
+ * Returns EARLY_OUT when no frame is ready yet, so the caller can retry.
+ */
 RETURN_STATUS ImageBuffer_NextImage(const ImageBuffer& buf, cv::Mat& img);
+/* Reference image at buffer head without copying.  Must not be modified.
+ * Returns EARLY_OUT when no frame is ready yet.
+ */
+RETURN_STATUS ImageBuffer_PeekImage(const ImageBuffer& buf, cv::Mat& img);
 /* Make image at buffer head available for new data */
 RETURN_STATUS ImageBuffer_ConsumeImage(ImageBuffer& buf);
 /* Shutdown loader threads and clean up image buffer resources */
@@ -0,0 +1,48 @@
+#ifndef VOXEL_GRID_HPP
+#define VOXEL_GRID_HPP
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "status.hpp"
+
+/* What a voxel keeps of the points that fall into it */
+enum VoxelColorMode {
+    /* Mean position and mean color */
+    VOXEL_CENTROID,
+    /* The input point nearest the voxel's center, with its own color */
+    VOXEL_REPRESENTATIVE,
+};
+
+/** Level-of-detail settings for point cloud logging.
+ *
+ * Each voxel size produces one level, logged under `<path>/lod<i>` in
+ * ascending voxel size order.  A size of 0 logs the cloud at full resolution.
+ * Every level is downsampled from the full cloud, so centroids are exact means
+ * of the input points at any voxel size.
+ */
+struct PointLod {
+    std::vector<float> voxel_sizes;
+    VoxelColorMode mode;
+};
+
+/** Downsample `points` onto a grid of `voxel_size` cubes, keeping one point per
+ * occupied voxel.
+ *
+ * Voxels are found by hashing their integer coordinates, and the work is split
+ * across OpenCV's thread pool by hash shard, so the output order is stable
+ * for a given input and thread count.  `colors`, if given, must match
+ * `points`; `out_colors` is then filled alongside `out_points`.  Non-finite
+ * points and points more than 2^20 voxels from the origin are dropped.  The
+ * outputs must not alias the inputs.
+ */
+RETURN_STATUS voxel_downsample(
+    const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>* colors,
+    float voxel_size,
+    VoxelColorMode mode,
+    std::vector<cv::Point3f>& out_points,
+    std::vector<cv::Vec3b>* out_colors = nullptr
+);
+
+#endif /* VOXEL_GRID_HPP */
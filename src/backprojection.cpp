@@ -0,0 +1,344 @@
+#include "backprojection.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+RETURN_STATUS RayTable_Init(
+    RayTable* table,
+    const cv::Matx33d& camera_matrix,
+    int width,
+    int height,
+    int stride
+) {
+    if (width <= 0 || height <= 0 || stride <= 0) {
+        fprintf(
+            stderr,
+            "Invalid ray table size %dx%d, stride %d\n",
+            width,
+            height,
+            stride
+        );
+        return ERROR;
+    }
+    double fx = camera_matrix(0, 0);
+    double fy = camera_matrix(1, 1);
+    double cx = camera_matrix(0, 2);
+    double cy = camera_matrix(1, 2);
+    if (fx == 0.0 || fy == 0.0) {
+        fprintf(stderr, "Camera matrix has zero focal length\n");
+        return ERROR;
+    }
+
+    table->camera_matrix = camera_matrix;
+    table->width = width;
+    table->height = height;
+    table->stride = stride;
+    table->cols = (width + stride - 1) / stride;
+    table->rows = (height + stride - 1) / stride;
+    size_t n = (size_t)table->cols * table->rows;
+    table->ray_x.resize(n);
+    table->ray_y.resize(n);
+    for (int r = 0; r < table->rows; ++r) {
+        float y = static_cast<float>((r * stride - cy) / fy);
+        for (int c = 0; c < table->cols; ++c) {
+            size_t i = (size_t)r * table->cols + c;
+            table->ray_x[i] = static_cast<float>((c * stride - cx) / fx);
+            table->ray_y[i] = y;
+        }
+    }
+    return OK;
+}
+
+bool RayTable_Matches(
+    const RayTable& table,
+    const cv::Matx33d& camera_matrix,
+    int width,
+    int height,
+    int stride
+) {
+    if (table.width != width || table.height != height ||
+        table.stride != stride) {
+        return false;
+    }
+    for (int i = 0; i < 9; ++i) {
+        if (table.camera_matrix.val[i] != camera_matrix.val[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* World-frame coordinates of one row of `n` samples, written as separate
+ * x/y/z arrays.  With X_world = R^T * d * ray + center and ray = (x, y, 1),
+ * each coordinate is d * (R^T row . ray) + center, two multiply-adds per
+ * coordinate.  The main loop uses OpenCV's universal intrinsics, so it runs
+ * on whichever SIMD width the build targets (SSE, AVX, NEON).
+ */
+static void backproject_row(
+    const float* ray_x,
+    const float* ray_y,
+    const float* depth,
+    int n,
+    const cv::Matx33f& rt,
+    const cv::Vec3f& center,
+    float* xs,
+    float* ys,
+    float* zs
+) {
+    float* out[3] = {xs, ys, zs};
+    int c = 0;
+#if CV_SIMD
+    const int lanes = cv::v_float32::nlanes;
+    cv::v_float32 v_rt[9];
+    cv::v_float32 v_center[3];
+    for (int i = 0; i < 9; ++i) {
+        v_rt[i] = cv::vx_setall_f32(rt.val[i]);
+    }
+    for (int i = 0; i < 3; ++i) {
+        v_center[i] = cv::vx_setall_f32(center[i]);
+    }
+    for (; c + lanes <= n; c += lanes) {
+        cv::v_float32 x = cv::vx_load(ray_x + c);
+        cv::v_float32 y = cv::vx_load(ray_y + c);
+        cv::v_float32 d = cv::vx_load(depth + c);
+        for (int i = 0; i < 3; ++i) {
+            cv::v_float32 w = cv::v_fma(
+                v_rt[3 * i],
+                x,
+                cv::v_fma(v_rt[3 * i + 1], y, v_rt[3 * i + 2])
+            );
+            cv::v_store(out[i] + c, cv::v_fma(w, d, v_center[i]));
+        }
+    }
+#endif
+    for (; c < n; ++c) {
+        for (int i = 0; i < 3; ++i) {
+            float w = rt.val[3 * i] * ray_x[c] +
+                      rt.val[3 * i + 1] * ray_y[c] + rt.val[3 * i + 2];
+            out[i][c] = w * depth[c] + center[i];
+        }
+    }
+}
+
+/* Back-project a band of sample rows.  Each row is computed into per-thread
+ * x/y/z scratch, then compacted: samples are written contiguously from `out`,
+ * advancing only over valid depths (branch-free), and the number kept is
+ * returned.
+ */
+static size_t backproject_rows(
+    const RayTable& table,
+    const cv::Mat& depth,
+    float plane_depth,
+    const cv::Matx33f& rt,
+    const cv::Vec3f& center,
+    const cv::Mat& image,
+    int row_begin,
+    int row_end,
+    cv::Point3f* points,
+    cv::Vec3b* colors
+) {
+    const int cols = table.cols;
+    const int stride = table.stride;
+    const int channels = image.empty() ? 0 : image.channels();
+    /* Kept across frames, so steady-state calls do not allocate */
+    thread_local std::vector<float> scratch;
+    scratch.resize((size_t)4 * cols);
+    float* xs = scratch.data();
+    float* ys = xs + cols;
+    float* zs = ys + cols;
+    float* samples = zs + cols;
+    if (depth.empty()) {
+        std::fill(samples, samples + cols, plane_depth);
+    }
+
+    size_t out = 0;
+    for (int r = row_begin; r < row_end; ++r) {
+        /* Depth samples of this row, contiguous */
+        const float* d = samples;
+        if (!depth.empty()) {
+            const float* depth_row = depth.ptr<float>(r * stride);
+            if (stride == 1) {
+                d = depth_row;
+            } else {
+                for (int c = 0; c < cols; ++c) {
+                    samples[c] = depth_row[c * stride];
+                }
+            }
+        }
+        size_t base = (size_t)r * cols;
+        backproject_row(
+            table.ray_x.data() + base,
+            table.ray_y.data() + base,
+            d,
+            cols,
+            rt,
+            center,
+            xs,
+            ys,
+            zs
+        );
+
+        const uint8_t* image_row =
+            (colors != nullptr && channels > 0) ? image.ptr<uint8_t>(r * stride)
+                                                : nullptr;
+        for (int c = 0; c < cols; ++c) {
+            points[out] = cv::Point3f(xs[c], ys[c], zs[c]);
+            if (image_row != nullptr) {
+                const uint8_t* px = image_row + (size_t)c * stride * channels;
+                colors[out] = channels >= 3 ? cv::Vec3b(px[0], px[1], px[2])
+                                            : cv::Vec3b(px[0], px[0], px[0]);
+            }
+            /* `d > 0` is false for NaN as well as for missing depth */
+            out += d[c] > 0.0f ? 1 : 0;
+        }
+    }
+    return out;
+}
+
+static RETURN_STATUS backproject(
+    const RayTable& table,
+    const cv::Mat& depth,
+    float plane_depth,
+    const cv::Matx31d& rvec,
+    const cv::Matx31d& tvec,
+    std::vector<cv::Point3f>& points,
+    const cv::Mat& image,
+    std::vector<cv::Vec3b>* colors
+) {
+    if (!depth.empty() &&
+        (depth.type() != CV_32FC1 || depth.cols != table.width ||
+         depth.rows != table.height)) {
+        fprintf(
+            stderr,
+            "Depth must be CV_32FC1 at %dx%d\n",
+            table.width,
+            table.height
+        );
+        return ERROR;
+    }
+    if (!image.empty() &&
+        (image.depth() != CV_8U || image.cols != table.width ||
+         image.rows != table.height)) {
+        fprintf(
+            stderr,
+            "Image must be 8-bit at %dx%d\n",
+            table.width,
+            table.height
+        );
+        return ERROR;
+    }
+
+    /* X_cam = R * X_world + t  =>  X_world = R^T * X_cam - R^T * t */
+    cv::Matx33d rot;
+    cv::Rodrigues(rvec, rot);
+    cv::Matx33d rot_t = rot.t();
+    cv::Matx31d center_d = rot_t * tvec;
+    cv::Matx33f rt = rot_t;
+    cv::Vec3f center(
+        static_cast<float>(-center_d(0, 0)),
+        static_cast<float>(-center_d(1, 0)),
+        static_cast<float>(-center_d(2, 0))
+    );
+
+    size_t n = table.ray_x.size();
+    points.resize(n);
+    cv::Vec3b* color_out = nullptr;
+    if (colors != nullptr && !image.empty()) {
+        colors->resize(n);
+        color_out = colors->data();
+    } else if (colors != nullptr) {
+        /* No image to sample, so no colors rather than a stale frame's */
+        colors->clear();
+    }
+
+    /* Bands of sample rows write into their own region of the output, then
+     * the kept points are packed together below.
+     */
+    int n_bands = std::max(1, std::min(table.rows, cv::getNumThreads() * 4));
+    int rows_per_band = (table.rows + n_bands - 1) / n_bands;
+    std::vector<size_t> kept(n_bands, 0);
+    cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range& range) {
+        for (int b = range.start; b < range.end; ++b) {
+            int row_begin = b * rows_per_band;
+            int row_end = std::min(table.rows, row_begin + rows_per_band);
+            if (row_begin >= row_end) {
+                continue;
+            }
+            size_t offset = (size_t)row_begin * table.cols;
+            kept[b] = backproject_rows(
+                table,
+                depth,
+                plane_depth,
+                rt,
+                center,
+                image,
+                row_begin,
+                row_end,
+                points.data() + offset,
+                color_out ? color_out + offset : nullptr
+            );
+        }
+    });
+
+    size_t total = 0;
+    for (int b = 0; b < n_bands; ++b) {
+        size_t offset = (size_t)b * rows_per_band * table.cols;
+        if (kept[b] == 0) {
+            continue;
+        }
+        if (offset != total) {
+            /* Destination precedes source, so a forward copy is safe */
+            std::copy(
+                points.begin() + offset,
+                points.begin() + offset + kept[b],
+                points.begin() + total
+            );
+            if (color_out != nullptr) {
+                std::copy(
+                    color_out + offset,
+                    color_out + offset + kept[b],
+                    color_out + total
+                );
+            }
+        }
+        total += kept[b];
+    }
+    points.resize(total);
+    if (color_out != nullptr) {
+        colors->resize(total);
+    }
+    return OK;
+}
+
+RETURN_STATUS backproject_depth(
+    const RayTable& table,
+    const cv::Mat& depth,
+    const cv::Matx31d& rvec,
+    const cv::Matx31d& tvec,
+    std::vector<cv::Point3f>& points,
+    const cv::Mat& image,
+    std::vector<cv::Vec3b>* colors
+) {
+    if (depth.empty()) {
+        fprintf(stderr, "Depth map is EMPTY!\n");
+        return ERROR;
+    }
+    return backproject(table, depth, 0.0f, rvec, tvec, points, image, colors);
+}
+
+RETURN_STATUS backproject_plane(
+    const RayTable& table,
+    float depth,
+    const cv::Matx31d& rvec,
+    const cv::Matx31d& tvec,
+    std::vector<cv::Point3f>& points,
+    const cv::Mat& image,
+    std::vector<cv::Vec3b>* colors
+) {
+    return backproject(
+        table, cv::Mat(), depth, rvec, tvec, points, image, colors
+    );
+}
@@ -0,0 +1,259 @@
+#include "frame_bus.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+static size_t slot_header_size() {
+    return align_up(sizeof(FrameBusSlot), FRAME_BUS_ALIGN);
+}
+
+static size_t header_size() {
+    return align_up(sizeof(FrameBusHeader), FRAME_BUS_ALIGN);
+}
+
+static FrameBusSlot* slot_at(
+    uint8_t* base, const FrameBusHeader* header, uint64_t idx
+) {
+    return reinterpret_cast<FrameBusSlot*>(
+        base + header_size() + (idx % header->slot_count) * header->slot_stride
+    );
+}
+
+static const FrameBusSlot* slot_at(
+    const uint8_t* base, const FrameBusHeader* header, uint64_t idx
+) {
+    return reinterpret_cast<const FrameBusSlot*>(
+        base + header_size() + (idx % header->slot_count) * header->slot_stride
+    );
+}
+
+RETURN_STATUS FrameBus_Create(
+    FrameBus* bus,
+    const std::string& name,
+    uint32_t slot_count,
+    size_t slot_bytes
+) {
+    if (slot_count < 2) {
+        fprintf(stderr, "Frame bus needs at least 2 slots\n");
+        return ERROR;
+    }
+    size_t slot_stride =
+        slot_header_size() + align_up(slot_bytes, FRAME_BUS_ALIGN);
+    size_t map_size = header_size() + slot_count * slot_stride;
+
+    /* Replace any segment left behind by a previous run */
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        fprintf(
+            stderr, "shm_open(%s) failed: %s\n", name.c_str(), strerror(errno)
+        );
+        return ERROR;
+    }
+    if (ftruncate(fd, map_size) != 0) {
+        fprintf(stderr, "ftruncate failed: %s\n", strerror(errno));
+        close(fd);
+        shm_unlink(name.c_str());
+        return ERROR;
+    }
+    void* base =
+        mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "mmap failed: %s\n", strerror(errno));
+        close(fd);
+        shm_unlink(name.c_str());
+        return ERROR;
+    }
+
+    bus->name = name;
+    bus->fd = fd;
+    bus->base = static_cast<uint8_t*>(base);
+    bus->map_size = map_size;
+    /* ftruncate zero-fills, so every slot sequence starts at 0 (empty) */
+    bus->header = new (bus->base) FrameBusHeader{};
+    bus->header->version = FRAME_BUS_VERSION;
+    bus->header->slot_count = slot_count;
+    bus->header->slot_stride = slot_stride;
+    bus->header->slot_bytes = slot_bytes;
+    bus->header->published.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; ++i) {
+        new (slot_at(bus->base, bus->header, i)) FrameBusSlot{};
+    }
+    /* Readers check the magic last, once the layout is fully written */
+    std::atomic_thread_fence(std::memory_order_release);
+    bus->header->magic = FRAME_BUS_MAGIC;
+    return OK;
+}
+
+RETURN_STATUS FrameBus_Publish(FrameBus* bus, const cv::Mat& img) {
+    size_t bytes = img.total() * img.elemSize();
+    if (!img.isContinuous() || bytes > bus->header->slot_bytes) {
+        fprintf(
+            stderr,
+            "Frame bus cannot hold frame of %zu bytes (slot is %lu)\n",
+            bytes,
+            (unsigned long)bus->header->slot_bytes
+        );
+        return ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(bus->write_mutex);
+    uint64_t frame_idx = bus->header->published.load(std::memory_order_relaxed);
+    FrameBusSlot* slot = slot_at(bus->base, bus->header, frame_idx);
+    uint8_t* payload = reinterpret_cast<uint8_t*>(slot) + slot_header_size();
+
+    uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->frame_idx = frame_idx;
+    slot->rows = img.rows;
+    slot->cols = img.cols;
+    slot->type = img.type();
+    slot->bytes = static_cast<uint32_t>(bytes);
+    memcpy(payload, img.data, bytes);
+    slot->seq.store(seq + 2, std::memory_order_release);
+
+    bus->header->published.store(frame_idx + 1, std::memory_order_release);
+    return OK;
+}
+
+void FrameBus_Destroy(FrameBus* bus) {
+    if (bus->base != nullptr) {
+        munmap(bus->base, bus->map_size);
+        close(bus->fd);
+        shm_unlink(bus->name.c_str());
+    }
+    bus->base = nullptr;
+    bus->header = nullptr;
+}
+
+RETURN_STATUS FrameBus_Open(
+    FrameBusReader* reader, const std::string& name, FrameBusPolicy policy
+) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(
+            stderr, "shm_open(%s) failed: %s\n", name.c_str(), strerror(errno)
+        );
+        return ERROR;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < header_size()) {
+        fprintf(stderr, "Frame bus %s is not initialized\n", name.c_str());
+        close(fd);
+        return ERROR;
+    }
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "mmap failed: %s\n", strerror(errno));
+        close(fd);
+        return ERROR;
+    }
+    const FrameBusHeader* header = static_cast<const FrameBusHeader*>(base);
+    bool valid = header->magic == FRAME_BUS_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid || header->version != FRAME_BUS_VERSION ||
+        (size_t)st.st_size <
+            header_size() + header->slot_count * header->slot_stride) {
+        fprintf(
+            stderr, "Frame bus %s has an incompatible layout\n", name.c_str()
+        );
+        munmap(base, st.st_size);
+        close(fd);
+        return ERROR;
+    }
+
+    reader->fd = fd;
+    reader->base = static_cast<const uint8_t*>(base);
+    reader->map_size = st.st_size;
+    reader->header = header;
+    reader->policy = policy;
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    reader->cursor = published > 0 ? published - 1 : 0;
+    reader->dropped = 0;
+    reader->held_slot = nullptr;
+    reader->held_seq = 0;
+    return OK;
+}
+
+RETURN_STATUS FrameBus_Acquire(FrameBusReader* reader, cv::Mat& view) {
+    const FrameBusHeader* header = reader->header;
+    while (true) {
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        if (reader->cursor >= published) {
+            return EARLY_OUT;
+        }
+        /* The writer's next slot is `published % slot_count`, so only the
+         * newest `slot_count - 1` frames are safe from being overwritten.
+         */
+        uint64_t oldest = published > header->slot_count - 1
+                              ? published - (header->slot_count - 1)
+                              : 0;
+        if (reader->cursor < oldest) {
+            uint64_t resume = reader->policy == FRAME_BUS_SKIP_TO_LATEST
+                                  ? published - 1
+                                  : oldest;
+            reader->dropped += resume - reader->cursor;
+            reader->cursor = resume;
+        }
+
+        const FrameBusSlot* slot =
+            slot_at(reader->base, header, reader->cursor);
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        uint64_t frame_idx = slot->frame_idx;
+        int rows = slot->rows;
+        int cols = slot->cols;
+        int type = slot->type;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq & 1) != 0 ||
+            slot->seq.load(std::memory_order_relaxed) != seq ||
+            frame_idx != reader->cursor) {
+            /* Lapped while looking up the slot; re-evaluate against the
+             * latest published count */
+            reader->dropped += 1;
+            reader->cursor += 1;
+            continue;
+        }
+
+        const uint8_t* payload =
+            reinterpret_cast<const uint8_t*>(slot) + slot_header_size();
+        view = cv::Mat(rows, cols, type, const_cast<uint8_t*>(payload));
+        reader->held_slot = slot;
+        reader->held_seq = seq;
+        return OK;
+    }
+}
+
+RETURN_STATUS FrameBus_Release(FrameBusReader* reader) {
+    if (reader->held_slot == nullptr) {
+        return ERROR;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool intact = reader->held_slot->seq.load(std::memory_order_relaxed) ==
+                  reader->held_seq;
+    reader->held_slot = nullptr;
+    reader->cursor += 1;
+    if (!intact) {
+        reader->dropped += 1;
+        return ERROR;
+    }
+    return OK;
+}
+
+void FrameBus_Close(FrameBusReader* reader) {
+    if (reader->base != nullptr) {
+        munmap(const_cast<uint8_t*>(reader->base), reader->map_size);
+        close(reader->fd);
+    }
+    reader->base = nullptr;
+    reader->header = nullptr;
+}
@@ -0,0 +1,67 @@
+/** Minimal out-of-process consumer for frames published with `--shm_name`.
+ *
+ * Usage: frame_bus_reader [NAME] [latest|oldest]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "frame_bus.hpp"
+
+int main(int argc, char** argv) {
+    std::string name = argc > 1 ? argv[1] : "/mve_frames";
+    FrameBusPolicy policy = FRAME_BUS_SKIP_TO_LATEST;
+    if (argc > 2 && std::string(argv[2]) == "oldest") {
+        policy = FRAME_BUS_OLDEST_AVAILABLE;
+    }
+
+    FrameBusReader reader = {};
+    if (FrameBus_Open(&reader, name, policy) != OK) {
+        return EXIT_FAILURE;
+    }
+    printf(
+        "Reading %s (%u slots, %s)\n",
+        name.c_str(),
+        reader.header->slot_count,
+        policy == FRAME_BUS_SKIP_TO_LATEST ? "latest" : "oldest"
+    );
+
+    uint64_t frames = 0;
+    uint64_t checksum = 0;
+    auto report_time = std::chrono::steady_clock::now();
+    cv::Mat view;
+    while (true) {
+        RETURN_STATUS status = FrameBus_Acquire(&reader, view);
+        if (status == EARLY_OUT) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else if (status == OK) {
+            /* Stand-in for real analysis: touch the frame in place */
+            uint64_t sum = 0;
+            for (size_t i = 0; i < view.total() * view.elemSize(); i += 64) {
+                sum += view.data[i];
+            }
+            if (FrameBus_Release(&reader) == OK) {
+                checksum += sum;
+                frames += 1;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - report_time >= std::chrono::seconds(1)) {
+            printf(
+                "frames: %lu  dropped: %lu  cursor: %lu  last: %dx%d  "
+                "checksum: %lu\n",
+                (unsigned long)frames,
+                (unsigned long)reader.dropped,
+                (unsigned long)reader.cursor,
+                view.cols,
+                view.rows,
+                (unsigned long)checksum
+            );
+            report_time = now;
+        }
+    }
+
+    FrameBus_Close(&reader);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+#include "frame_fingerprint.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Block hashes accumulate each block row 32 bytes (one stripe) at a time into
+ * four 64-bit lanes, as XXH3 does: every lane adds its neighbour's input word
+ * and the product of the low and high halves of its own word XORed with a
+ * key.  The key advances every stripe and the lanes are scrambled after every
+ * row segment, so moving data within a block changes its hash.  SSE2 builds
+ * process two lanes per instruction with 32x32->64-bit multiplies
+ * (`_mm_mul_epu32`); other targets run the same arithmetic on scalars, so
+ * fingerprints match across both.
+ */
+static const uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+static const uint32_t PRIME32_1 = 0x9E3779B1U;
+static const int HASH_LANES = 4;
+static const int HASH_STRIPE = 8 * HASH_LANES;
+static const uint64_t HASH_KEY[HASH_LANES] = {
+    0xBE4BA423396CFEB8ULL,
+    0x1CAD21F72C81017CULL,
+    0xDB979083E96DD4DEULL,
+    0x1F67B3B7A4A44072ULL,
+};
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+#if defined(__SSE2__)
+static inline void hash_stripe(
+    __m128i acc[2], __m128i key[2], const uint8_t* data
+) {
+    for (int i = 0; i < 2; ++i) {
+        __m128i words = _mm_loadu_si128((const __m128i*)(data + 16 * i));
+        __m128i mixed = _mm_xor_si128(words, key[i]);
+        /* High half of each word into the low half, for `_mm_mul_epu32` */
+        __m128i mixed_hi = _mm_shuffle_epi32(mixed, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i product = _mm_mul_epu32(mixed, mixed_hi);
+        __m128i swapped = _mm_shuffle_epi32(words, _MM_SHUFFLE(1, 0, 3, 2));
+        acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+        key[i] = _mm_add_epi64(key[i], _mm_set1_epi64x((int64_t)PRIME_3));
+    }
+}
+
+/* acc = (acc ^ (acc >> 47)) * PRIME32_1, from two 32x32->64-bit multiplies */
+static inline __m128i hash_scramble(__m128i acc) {
+    const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+    acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+    __m128i lo = _mm_mul_epu32(acc, prime);
+    __m128i hi = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+    return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+}
+
+static void hash_segment(const uint8_t* data, size_t len, uint64_t* lanes) {
+    __m128i acc[2] = {
+        _mm_loadu_si128((const __m128i*)lanes),
+        _mm_loadu_si128((const __m128i*)(lanes + 2)),
+    };
+    __m128i key[2] = {
+        _mm_loadu_si128((const __m128i*)HASH_KEY),
+        _mm_loadu_si128((const __m128i*)(HASH_KEY + 2)),
+    };
+    size_t i = 0;
+    for (; i + HASH_STRIPE <= len; i += HASH_STRIPE) {
+        hash_stripe(acc, key, data + i);
+    }
+    if (i < len) {
+        uint8_t tail[HASH_STRIPE] = {};
+        memcpy(tail, data + i, len - i);
+        hash_stripe(acc, key, tail);
+    }
+    _mm_storeu_si128((__m128i*)lanes, hash_scramble(acc[0]));
+    _mm_storeu_si128((__m128i*)(lanes + 2), hash_scramble(acc[1]));
+}
+#else
+static inline void hash_stripe(
+    uint64_t* lanes, uint64_t* key, const uint8_t* data
+) {
+    uint64_t words[HASH_LANES];
+    memcpy(words, data, sizeof(words));
+    for (int k = 0; k < HASH_LANES; ++k) {
+        uint64_t mixed = words[k] ^ key[k];
+        lanes[k ^ 1] += words[k];
+        lanes[k] += (mixed & 0xFFFFFFFFULL) * (mixed >> 32);
+        key[k] += PRIME_3;
+    }
+}
+
+static void hash_segment(const uint8_t* data, size_t len, uint64_t* lanes) {
+    uint64_t key[HASH_LANES];
+    memcpy(key, HASH_KEY, sizeof(key));
+    size_t i = 0;
+    for (; i + HASH_STRIPE <= len; i += HASH_STRIPE) {
+        hash_stripe(lanes, key, data + i);
+    }
+    if (i < len) {
+        uint8_t tail[HASH_STRIPE] = {};
+        memcpy(tail, data + i, len - i);
+        hash_stripe(lanes, key, tail);
+    }
+    for (int k = 0; k < HASH_LANES; ++k) {
+        lanes[k] = (lanes[k] ^ (lanes[k] >> 47)) * PRIME32_1;
+    }
+}
+#endif
+
+static uint64_t hash_finalize(const uint64_t* lanes) {
+    uint64_t h = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) +
+                 rotl64(lanes[2], 12) + rotl64(lanes[3], 18);
+    h ^= h >> 33;
+    h *= PRIME_2;
+    h ^= h >> 29;
+    h *= PRIME_3;
+    h ^= h >> 32;
+    return h;
+}
+
+void FrameFingerprint_Compute(
+    const cv::Mat& img, int block_size, FrameFingerprint& fp
+) {
+    fp.rows = img.rows;
+    fp.cols = img.cols;
+    fp.type = img.type();
+    fp.block_size = block_size;
+    fp.blocks_x = (img.cols + block_size - 1) / block_size;
+    fp.blocks_y = (img.rows + block_size - 1) / block_size;
+    fp.block_hashes.resize((size_t)fp.blocks_x * fp.blocks_y);
+
+    /* Walk the frame row by row so memory is read sequentially, feeding each
+     * row's segments into the lanes of the block they belong to.
+     */
+    size_t elem_size = img.elemSize();
+    std::vector<uint64_t>& lanes = fp.lanes;
+    lanes.resize((size_t)fp.blocks_x * HASH_LANES);
+    for (int by = 0; by < fp.blocks_y; ++by) {
+        for (int bx = 0; bx < fp.blocks_x; ++bx) {
+            uint64_t* l = &lanes[(size_t)bx * HASH_LANES];
+            l[0] = PRIME_1 + PRIME_2;
+            l[1] = PRIME_2;
+            l[2] = 0;
+            l[3] = 0 - PRIME_1;
+        }
+        int row_end = std::min(img.rows, (by + 1) * block_size);
+        for (int r = by * block_size; r < row_end; ++r) {
+            const uint8_t* row = img.ptr<uint8_t>(r);
+            for (int bx = 0; bx < fp.blocks_x; ++bx) {
+                int col = bx * block_size;
+                int width = std::min(block_size, img.cols - col);
+                hash_segment(
+                    row + col * elem_size,
+                    width * elem_size,
+                    &lanes[(size_t)bx * HASH_LANES]
+                );
+            }
+        }
+        for (int bx = 0; bx < fp.blocks_x; ++bx) {
+            fp.block_hashes[(size_t)by * fp.blocks_x + bx] =
+                hash_finalize(&lanes[(size_t)bx * HASH_LANES]);
+        }
+    }
+}
+
+FrameChange FrameChange_Full(const cv::Mat& img) {
+    FrameChange change = {};
+    change.full = true;
+    change.dirty_bounds = cv::Rect(0, 0, img.cols, img.rows);
+    change.dirty_fraction = 1.0f;
+    return change;
+}
+
+FrameChange FrameFingerprint_Update(
+    FrameFingerprint& fp, const cv::Mat& img, int block_size
+) {
+    /* Swap rather than copy, so both hash vectors keep their capacity */
+    bool had_previous = !fp.block_hashes.empty();
+    bool same_shape = fp.rows == img.rows && fp.cols == img.cols &&
+                      fp.type == img.type() && fp.block_size == block_size;
+    fp.previous_hashes.swap(fp.block_hashes);
+    FrameFingerprint_Compute(img, block_size, fp);
+
+    if (!had_previous || !same_shape) {
+        return FrameChange_Full(img);
+    }
+
+    FrameChange change = {};
+    for (int by = 0; by < fp.blocks_y; ++by) {
+        for (int bx = 0; bx < fp.blocks_x; ++bx) {
+            size_t idx = (size_t)by * fp.blocks_x + bx;
+            if (fp.previous_hashes[idx] == fp.block_hashes[idx]) {
+                continue;
+            }
+            int x = bx * block_size;
+            int y = by * block_size;
+            cv::Rect block(
+                x,
+                y,
+                std::min(block_size, img.cols - x),
+                std::min(block_size, img.rows - y)
+            );
+            change.dirty_bounds = change.dirty_blocks.empty()
+                                      ? block
+                                      : (change.dirty_bounds | block);
+            change.dirty_blocks.push_back(block);
+        }
+    }
+    change.unchanged = change.dirty_blocks.empty();
+    change.dirty_fraction =
+        (float)change.dirty_blocks.size() / fp.block_hashes.size();
+    return change;
+}
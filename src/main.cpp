@@ -15,44 +15,120 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
+#ifdef SKIP_ALL_LOG
+    /* Nothing is logged, so don't connect, record or start the SDK's batcher */
+    cli.enable_rerun = false;
+#endif
     /* This must be set prior to creating the `RecordingStream`. However, if set
      * to false and a connection is established, no logs are sent
      */
     if (!cli.enable_rerun) {
         rerun::set_default_enabled(false);
+    } else if (RerunSink_ApplyBatching(cli.sink) != OK) {
+        return EXIT_FAILURE;
     }
 
     const auto rec = rerun::RecordingStream("mve");
     if (cli.enable_rerun) {
-        if (!rec.connect_tcp(cli.viewer_addr).is_ok()) {
-            fprintf(stderr, "Failed to spawn Rerun\n");
+        if (RerunSink_Open(cli.sink, rec) != OK) {
             return 1;
-        } else {
-            printf("Connected to %s\n", cli.viewer_addr.c_str());
         }
     } else {
         printf("Rerun logging disabled.\n");
     }
 
+    if (ThreadConfig_Resolve(cli.thread_config) != OK) {
+        return EXIT_FAILURE;
+    }
+    /* Pin the consumer before any frame memory is allocated.  The main thread
+     * keeps its name, which is also the process name.
+     */
+    ThreadConfig_Apply(
+        cli.thread_config, nullptr, cli.thread_config.consumer_cpus
+    );
+    int memory_node = ThreadConfig_MemoryNode(cli.thread_config);
+    if (memory_node >= 0) {
+        ThreadConfig_PreferNode(memory_node);
+    }
+
     ImageBuffer buf = {};
-    if (ImageBuffer_Init(&buf, "doom_gif", 20, 1) != OK) {
+    ImageBuffer_SetThreadConfig(&buf, cli.thread_config);
+    if (!cli.shm_name.empty()) {
+        ImageBuffer_PublishTo(&buf, cli.shm_name, cli.shm_slots);
+    }
+    ImageBuffer_AllowResident(&buf, cli.resident_mb * 1024 * 1024);
+    auto warmup_start = std::chrono::steady_clock::now();
+    if (ImageBuffer_Init(
+            &buf, "doom_gif", 20, cli.threads, cli.decode, cli.ready_frames
+        ) != OK) {
         return EXIT_FAILURE;
     }
-    ImageBuffer_Stats(buf);
     printf("Warming up background loader...\n");
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    if (ImageBuffer_WaitReady(buf, std::chrono::seconds(30)) != OK) {
+        ImageBuffer_Shutdown(buf);
+        return EXIT_FAILURE;
+    }
+    printf(
+        "Buffer ready after %.1fms\n",
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - warmup_start
+        )
+            .count()
+    );
+    ImageBuffer_Stats(buf);
     printf("Starting image loop...\n");
 
-    if (buf.images.size() <= 0) {
+    cv::Mat first;
+    if (ImageBuffer_PeekImage(buf, first) != OK || first.empty()) {
         fprintf(stderr, "Image buffer has no images\n");
         return 1;
     }
-    cv::Mat img(buf.images[0].rows, buf.images[0].cols, buf.images[0].type());
+    cv::Mat img(first.rows, first.cols, first.type());
+    rerun::ColorModel color_model =
+        cli.decode.grayscale ? rerun::ColorModel::L : rerun::ColorModel::BGR;
+    const RrPath images_path = rr_path("images");
+    RerunSinkStats sink_stats;
+    RerunSinkStats_Init(&sink_stats, cli.sink);
     while(true) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-        ImageBuffer_NextImage(buf, img);
-        rr_log_mat_image("images", img, rerun::ColorModel::BGR, rec);
+        /* Loaders may still be filling the buffer past `ready_frames` */
+        RETURN_STATUS status;
+        if (buf.resident) {
+            status = ImageBuffer_PeekImage(buf, img);
+        } else {
+            /* Frames in a folder may differ in size or type.  `create` only
+             * reallocates when the head frame's shape changes.
+             */
+            cv::Mat head;
+            status = ImageBuffer_PeekImage(buf, head);
+            if (status == OK) {
+                img.create(head.rows, head.cols, head.type());
+                status = ImageBuffer_NextImage(buf, img);
+            }
+        }
+        if (status == EARLY_OUT) {
+            continue;
+        }
+        if (status != OK) {
+            /* Drop a frame that can't be copied instead of retrying it */
+            if (ImageBuffer_ConsumeImage(buf) != OK) {
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+        auto log_start = std::chrono::steady_clock::now();
+        if (cli.skip_unchanged) {
+            rr_log_mat_image_if_changed(images_path, img, color_model, rec);
+        } else {
+            rr_log_mat_image(images_path, img, color_model, rec);
+        }
+        if (cli.enable_rerun && cli.sink.report_stats) {
+            RerunSinkStats_AddLog(
+                &sink_stats, std::chrono::steady_clock::now() - log_start
+            );
+            RerunSinkStats_Report(&sink_stats, rec);
+        }
         if (ImageBuffer_ConsumeImage(buf) != OK) {
             return EXIT_FAILURE;
         }
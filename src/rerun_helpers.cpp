@@ -1,50 +1,115 @@
 #include "rerun_helpers.hpp"
 
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
 #include <iostream>
+#include <mutex>
 #include <opencv2/imgproc.hpp>
 #include <set>
+#include <unordered_map>
 
+#include "backprojection.hpp"
 #include "matrix_helpers.hpp"
 
 /** NOTE: According to Rerun, if RecordingStream is not enabled, all log
- * functions "early out".  See `RecordingStream::is_enabled()`
+ * functions "early out".  See `RecordingStream::is_enabled()`.  Archetypes are
+ * still built before that check, though, so every helper checks `rr_enabled`
+ * before doing any work of its own.
  */
 
+/** Interned entity paths.  Set nodes never move, so `RrPath` handles can point
+ * straight at the stored strings for the life of the program.
+ */
+static std::set<std::string, std::less<>> interned_paths;
+static std::mutex interned_paths_mutex;
+
+RrPath rr_path(std::string_view path) {
+    std::lock_guard<std::mutex> lock(interned_paths_mutex);
+    auto it = interned_paths.find(path);
+    if (it == interned_paths.end()) {
+        it = interned_paths.emplace(path).first;
+    }
+    return RrPath{&*it};
+}
+
+RrPath rr_path_child(RrPath parent, std::string_view child) {
+    /* Reused across calls, so lookups of known children do not allocate */
+    thread_local std::string key;
+    key.assign(*parent.str);
+    key += '/';
+    key += child;
+    return rr_path(key);
+}
+
+/* `parent/child` in `buf`, which keeps its capacity across calls.  Unlike
+ * `rr_path_child`, nothing is interned, so arbitrary paths don't accumulate.
+ */
+static std::string_view join_path(
+    std::string& buf, std::string_view parent, std::string_view child
+) {
+    buf.assign(parent);
+    buf += '/';
+    buf += child;
+    return buf;
+}
+
+std::string_view rr_format(const char* fmt, ...) {
+    thread_local std::vector<char> buf(256);
+    va_list args;
+    va_list retry;
+    va_start(args, fmt);
+    va_copy(retry, args);
+    int n = vsnprintf(buf.data(), buf.size(), fmt, args);
+    va_end(args);
+    if (n >= 0 && (size_t)n >= buf.size()) {
+        buf.resize(n + 1);
+        vsnprintf(buf.data(), buf.size(), fmt, retry);
+    }
+    va_end(retry);
+    return std::string_view(buf.data(), n < 0 ? 0 : n);
+}
+
 /** Log text to stdout or stderr and, if enabled, to the Rerun viewer */
-void rr_log_message(
-    std::string path,
-    const char* message,
+void rr_log_text(
+    std::string_view path,
+    std::string_view text,
     const rerun::RecordingStream& rec,
     TextLogLevel level
 ) {
     if (level.c_str() == TextLogLevel::Error.c_str()) {
-        std::cerr << message << std::endl;
+        std::cerr << text << std::endl;
     } else {
-        std::cout << message << std::endl;
+        std::cout << text << std::endl;
     }
-    rec.log(path, rerun::TextLog(message).with_level(level));
-    return;
+    rr_log_lazy(rec, path, [&] {
+        return rerun::TextLog(std::string(text)).with_level(level);
+    });
+}
+
+void rr_log_message(
+    std::string_view path,
+    const char* message,
+    const rerun::RecordingStream& rec,
+    TextLogLevel level
+) {
+    rr_log_text(path, message, rec, level);
 }
 
 /** Logs stringstream content to stdout and, if enabled, Rerun, then clears the
  * stringstream.
  */
 void rr_log_stream_and_clear(
-    std::string path,
+    std::string_view path,
     std::stringstream& ss,
     const rerun::RecordingStream& rec,
     TextLogLevel level
 ) {
-    if (level.c_str() == TextLogLevel::Error.c_str()) {
-        std::cerr << ss.str() << std::endl;
-    } else {
-        std::cout << ss.str() << std::endl;
-    }
-    rec.log(path, rerun::TextLog(ss.str()).with_level(level));
+    rr_log_text(path, ss.str(), rec, level);
     ss.str("");
-    return;
 }
 
+#ifndef SKIP_ALL_LOG
 /** Converts `cv::Matx44f` transformation matrix and logs it to Rerun
  *
  * Note that this will transform whatever 3D components are also logged at
@@ -53,11 +118,14 @@ void rr_log_stream_and_clear(
  * same path.
  */
 void rr_log_transform3d(
-    std::string path,
-    cv::Matx44f transform,
+    std::string_view path,
+    const cv::Matx44f& transform,
     rerun::Vec3D scale,
     const rerun::RecordingStream& rec
 ) {
+    if (!rr_enabled(rec)) {
+        return;
+    }
     cv::Matx33f cv_rot = rotation_from_transform(transform);
     cv::Matx31f cv_xlat = translation_from_transform(transform);
     auto xlat = rerun::components::Translation3D(
@@ -76,19 +144,23 @@ void rr_log_transform3d(
 
 /** Log an axis system to rerun */
 void rr_log_axis_system(
-    std::string path, float scale, const rerun::RecordingStream& rec
+    std::string_view path, float scale, const rerun::RecordingStream& rec
 ) {
-    std::vector<rerun::Vec3D> vecs = {
+    if (!rr_enabled(rec)) {
+        return;
+    }
+    /* Fixed-size arrays are borrowed by the SDK rather than copied */
+    const std::array<rerun::Vec3D, 3> vecs = {{
         {scale, 0.0f, 0.0f},
         {0.0f, scale, 0.0f},
         {0.0f, 0.0f, scale},
-    };
-    std::vector<rerun::Position3D> origins = {
+    }};
+    static const std::array<rerun::Position3D, 3> origins = {{
         {0.0f, 0.0f, 0.0f},
         {0.0f, 0.0f, 0.0f},
         {0.0f, 0.0f, 0.0f},
-    };
-    std::vector<rerun::Color> colors = {
+    }};
+    static const std::array<rerun::Color, 3> colors = {
         rerun::Color(255, 0, 0, 255),
         rerun::Color(0, 255, 0, 255),
         rerun::Color(0, 0, 255, 255),
@@ -100,60 +172,236 @@ void rr_log_axis_system(
         )
     );
 }
+#endif
 
 #ifndef SKIP_IMG_LOG
 void rr_log_mat_image(
-    std::string path,
-    cv::Mat img,
+    std::string_view path,
+    const cv::Mat& img,
     rerun::ColorModel color_model,
     const rerun::RecordingStream& rec,
-    std::string tag
+    std::string_view tag
 ) {
+    if (!rr_enabled(rec)) {
+        return;
+    }
+    const cv::Mat* logged = &img;
     if (!tag.empty()) {
+        /* Drawn on a copy: `img` may share its pixels with a buffered frame.
+         * Both are reused across calls, so same-sized frames do not allocate.
+         */
+        thread_local cv::Mat tagged;
+        thread_local std::string tag_text;
+        img.copyTo(tagged);
+        tag_text.assign(tag);
         cv::putText(
-            img, tag, {10, 10}, cv::FONT_HERSHEY_SIMPLEX, 1, {0, 255, 0}
+            tagged, tag_text, {10, 10}, cv::FONT_HERSHEY_SIMPLEX, 1, {0, 255, 0}
         );
+        logged = &tagged;
     }
     rec.log(
         path,
         rerun::Image(
-            rerun::borrow(img.data, img.total() * img.elemSize()),
+            rerun::borrow(logged->data, logged->total() * logged->elemSize()),
             rerun::WidthHeight(
-                static_cast<uint32_t>(img.cols), static_cast<uint32_t>(img.rows)
+                static_cast<uint32_t>(logged->cols),
+                static_cast<uint32_t>(logged->rows)
             ),
             color_model
         )
     );
 }
+
+/** Logs `img` only when its fingerprint differs from the previous frame at
+ * `path`.  Static cameras and looping datasets repeat frames constantly, and
+ * skipping them avoids re-sending identical pixels to the viewer.
+ */
+FrameChange rr_log_mat_image_if_changed(
+    RrPath path,
+    const cv::Mat& img,
+    rerun::ColorModel color_model,
+    const rerun::RecordingStream& rec
+) {
+    if (!rr_enabled(rec)) {
+        return FrameChange_Full(img);
+    }
+    FrameChange change = rr_image_change(path, img);
+    if (!change.unchanged) {
+        rr_log_mat_image(path, img, color_model, rec);
+    }
+    return change;
+}
 #endif
 
+/* Each path hashes under its own lock, so cameras on different paths
+ * fingerprint in parallel
+ */
+struct FingerprintEntry {
+    std::mutex mutex;
+    FrameFingerprint fp;
+};
+
+/** Fingerprints of the last frame seen by `rr_image_change`, keyed by interned
+ * path so lookups never build a string.  Entries are never erased, and map
+ * nodes do not move, so an entry stays valid after the map lock is dropped.
+ */
+static std::unordered_map<const std::string*, FingerprintEntry>
+    frame_fingerprints;
+static std::mutex frame_fingerprints_mutex;
+
+FrameChange rr_image_change(RrPath path, const cv::Mat& img) {
+    FingerprintEntry* entry;
+    {
+        std::lock_guard<std::mutex> lock(frame_fingerprints_mutex);
+        entry = &frame_fingerprints[path.str];
+    }
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    return FrameFingerprint_Update(entry->fp, img);
+}
+
+#ifndef SKIP_ALL_LOG
 void rr_log_keypoints_image(
-    std::string path,
-    std::vector<cv::KeyPoint> keypoints,
-    cv::Mat image,
+    std::string_view path,
+    const std::vector<cv::KeyPoint>& keypoints,
+    const cv::Mat& image,
     const rerun::RecordingStream& rec
 ) {
-    cv::Mat draw;
+    if (!rr_enabled(rec)) {
+        return;
+    }
+    /* Reallocated only when the frame size changes */
+    thread_local cv::Mat draw;
     cv::cvtColor(image, draw, cv::COLOR_GRAY2BGR);
     cv::drawKeypoints(draw, keypoints, draw);
     rr_log_mat_image(path, draw, rerun::ColorModel::BGR, rec);
 }
 
-void rr_log_points3d(
-    std::string path,
+/* Log points with one radius and either per-point BGR colors or white */
+static void log_points(
+    std::string_view path,
+    const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>* colors,
+    rerun::components::Radius radius,
+    const rerun::RecordingStream& rec
+) {
+    /* Keeps its capacity across calls */
+    thread_local std::vector<rerun::Color> rr_colors;
+    rr_colors.clear();
+    if (colors != nullptr) {
+        rr_colors.reserve(colors->size());
+        for (const cv::Vec3b& bgr : *colors) {
+            rr_colors.emplace_back(bgr[2], bgr[1], bgr[0], 255);
+        }
+    } else {
+        rr_colors.emplace_back(255, 255, 255, 255);
+    }
+    /* cv::Point3f is three packed floats, so it can be borrowed as positions */
+    static_assert(sizeof(cv::Point3f) == sizeof(rerun::Position3D));
+    rec.log(
+        path,
+        rerun::Points3D(
+            rerun::Collection<rerun::Position3D>::borrow(
+                reinterpret_cast<const rerun::Position3D*>(points.data()),
+                points.size()
+            )
+        )
+            .with_colors(rr_colors)
+            .with_radii(radius)
+    );
+}
+
+/** Log one voxel-downsampled level per `lod.voxel_sizes` entry under
+ * `<path>/lod<i>`.  Points are drawn with a radius of half their voxel, so
+ * coarse levels still cover the same surfaces.
+ */
+static void log_point_lod(
+    std::string_view path,
     const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>* colors,
+    rerun::components::Radius full_radius,
+    const PointLod& lod,
     const rerun::RecordingStream& rec
 ) {
-    std::vector<std::array<float, 3>> pts;
-    std::vector<rerun::Color> colors;
-    std::vector<float> radii;
-    for (const cv::Point3f& pt : points) {
-        pts.push_back({pt.x, pt.y, pt.z});
-        colors.emplace_back(255, 255, 255, 255);
-        radii.push_back(0.1f);
+    thread_local std::vector<float> sizes;
+    sizes.assign(lod.voxel_sizes.begin(), lod.voxel_sizes.end());
+    std::sort(sizes.begin(), sizes.end());
+
+    /* Every level is downsampled from the full cloud.  Cascading from the
+     * previous level would average centroids without their point counts, and
+     * coarse voxels do not nest finer ones unless sizes are multiples.
+     */
+    thread_local std::vector<cv::Point3f> level_points;
+    thread_local std::vector<cv::Vec3b> level_colors;
+    thread_local std::string level_buf;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        std::string_view level_path =
+            join_path(level_buf, path, rr_format("lod%zu", i));
+        if (sizes[i] <= 0.0f) {
+            log_points(level_path, points, colors, full_radius, rec);
+            continue;
+        }
+        std::vector<cv::Vec3b>* dst_colors =
+            colors != nullptr ? &level_colors : nullptr;
+        if (voxel_downsample(
+                points, colors, sizes[i], lod.mode, level_points, dst_colors
+            ) != OK) {
+            rr_log_message(
+                level_path,
+                "Voxel downsampling failed",
+                rec,
+                rerun::TextLogLevel::Error
+            );
+            return;
+        }
+        log_points(
+            level_path,
+            level_points,
+            dst_colors,
+            rerun::components::Radius(0.5f * sizes[i]),
+            rec
+        );
+    }
+}
+
+void rr_log_points3d(
+    std::string_view path,
+    const std::vector<cv::Point3f>& points,
+    const rerun::RecordingStream& rec,
+    const PointLod* lod
+) {
+    if (!rr_enabled(rec)) {
+        return;
+    }
+    rerun::components::Radius radius(0.1f);
+    if (lod != nullptr && !lod->voxel_sizes.empty()) {
+        log_point_lod(path, points, nullptr, radius, *lod, rec);
+    } else {
+        log_points(path, points, nullptr, radius, rec);
+    }
+}
+
+void rr_log_points3d(
+    std::string_view path,
+    const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>& colors,
+    const rerun::RecordingStream& rec,
+    const PointLod* lod
+) {
+    if (!rr_enabled(rec)) {
+        return;
+    }
+    if (colors.size() != points.size()) {
+        rr_log_points3d(path, points, rec, lod);
+        return;
+    }
+    auto radius = rerun::components::Radius::ui_points(1.0f);
+    if (lod != nullptr && !lod->voxel_sizes.empty()) {
+        log_point_lod(path, points, &colors, radius, *lod, rec);
+    } else {
+        log_points(path, points, &colors, radius, rec);
     }
-    rec.log(path, rerun::Points3D(pts).with_colors(colors).with_radii(radii));
 }
+#endif
 
 /** Logs source image and pose estimation results to Rerun
  *
@@ -161,23 +409,77 @@ void rr_log_points3d(
  * frustum, and transformation matrix.
  */
 void rr_log_pose_estimation(
-    std::string path,
-    const cv::Mat image,
+    std::string_view path,
+    const cv::Mat& image,
     const cv::Matx31d& rvec,
     const cv::Matx31d& tvec,
     const cv::Matx33d& camera_matrix,
-    const rerun::RecordingStream& rec
+    const rerun::RecordingStream& rec,
+    const cv::Mat& depth,
+    int stride,
+    const PointLod* lod
 ) {
-    std::stringstream log_ss;
-    std::string main_log_path = path + "/pose_estimate";
+    /* Child paths are built in per-thread buffers rather than interned, as
+     * `path` may differ on every call
+     */
+    thread_local std::string main_buf;
+    thread_local std::string image_buf;
+    thread_local std::string child_buf;
+    std::string_view main_log_path =
+        join_path(main_buf, path, "pose_estimate");
+
+    rr_log_text(
+        main_log_path,
+        rr_format(
+            "curr_rvec = [%g, %g, %g]", rvec(0, 0), rvec(1, 0), rvec(2, 0)
+        ),
+        rec
+    );
+    rr_log_text(
+        main_log_path,
+        rr_format(
+            "curr_tvec = [%g, %g, %g]", tvec(0, 0), tvec(1, 0), tvec(2, 0)
+        ),
+        rec
+    );
+
+    // Log camera intrinsics
+    const cv::Matx33d& k = camera_matrix;
+    rr_log_text(
+        join_path(child_buf, main_log_path, "calibration"),
+        rr_format(
+            "Camera Matrix: [%g, %g, %g;\n %g, %g, %g;\n %g, %g, %g]",
+            k(0, 0),
+            k(0, 1),
+            k(0, 2),
+            k(1, 0),
+            k(1, 1),
+            k(1, 2),
+            k(2, 0),
+            k(2, 1),
+            k(2, 2)
+        ),
+        rec
+    );
+
+    std::string_view image_log_path =
+        join_path(image_buf, main_log_path, "image");
+    if (image.empty()) {
+        rr_log_message(
+            image_log_path, "Image is EMPTY!", rec, rerun::TextLogLevel::Error
+        );
+    }
 
-    log_ss << "curr_rvec = [" << rvec(0, 0) << ", " << rvec(1, 0) << ", "
-           << rvec(2, 0) << "]";
-    rr_log_stream_and_clear(main_log_path, log_ss, rec);
+    /* Only the console output above is needed when logging is off.  Skips the
+     * Rodrigues conversion, inversion and back-projection below.
+     */
+    if (!rr_enabled(rec)) {
+        return;
+    }
 
     // TODO : Find a better way to log Vec3D, preferably something queryable
     rec.log(
-        main_log_path + "/pose_vecs/rvec",
+        join_path(child_buf, main_log_path, "pose_vecs/rvec"),
         rerun::Tensor().with_data(
             rerun::TensorData(
                 {3, 1},
@@ -187,11 +489,8 @@ void rr_log_pose_estimation(
             )
         )
     );
-    log_ss << "curr_tvec = [" << tvec(0, 0) << ", " << tvec(1, 0) << ", "
-           << tvec(2, 0) << "]";
-    rr_log_stream_and_clear(main_log_path, log_ss, rec);
     rec.log(
-        main_log_path + "/pose_vecs/tvec",
+        join_path(child_buf, main_log_path, "pose_vecs/tvec"),
         rerun::Tensor().with_data(
             rerun::TensorData(
                 {3, 1},
@@ -202,10 +501,6 @@ void rr_log_pose_estimation(
         )
     );
 
-    // Log camera intrinsics
-    log_ss << "Camera Matrix: " << camera_matrix;
-    rr_log_stream_and_clear(main_log_path + "/calibration", log_ss, rec);
-
     // Transform image and pinhole
     cv::Matx44f transform =
         transform_from_translation_rotation_rodrigues(tvec, rvec);
@@ -214,7 +509,7 @@ void rr_log_pose_estimation(
      * is the inverse of the view matrix. We aslo need to convert from RUB
      * orientation to RFU.
      */
-    cv::Matx44f rfu_to_rub = {
+    static const cv::Matx44f rfu_to_rub = {
         // clang-format off
         1.0f, 0.0f, 0.0f, 0.0f,
         0.0f, 0.0f, -1.0f, 0.0f,
@@ -225,23 +520,56 @@ void rr_log_pose_estimation(
     transform = rfu_to_rub * transform.inv();
 
     // Log the world axis system (default is RUB in rerun)
-    std::string axis_system_path = main_log_path + "/axis";
+    std::string_view axis_system_path =
+        join_path(child_buf, main_log_path, "axis");
     rr_log_axis_system(axis_system_path, 1.0, rec);
     rr_log_transform3d(
         axis_system_path, rfu_to_rub, {10.0f, 10.0f, 10.0f}, rec
     );
 
     // Log source image with pose estimate and camera intrinsics
-    std::string image_log_path = main_log_path + "/image";
-    if (image.empty()) {
-        rr_log_message(
-            image_log_path, "Image is EMPTY!", rec, rerun::TextLogLevel::Error
-        );
-    } else {
-        // Log dummy image in place of logging back-projected points to Rerun
+    if (!image.empty()) {
         rr_log_mat_image(image_log_path, image, rerun::ColorModel::BGR, rec);
     }
 
+    // Back-project the depth map into world-frame points
+    if (!depth.empty()) {
+        /* Rays only depend on the intrinsics and resolution, so keep them
+         * across frames.  Clouds are reused to avoid reallocating per frame.
+         */
+        thread_local RayTable rays = {};
+        thread_local std::vector<cv::Point3f> points;
+        thread_local std::vector<cv::Vec3b> colors;
+        std::string_view points_log_path =
+            join_path(child_buf, main_log_path, "points");
+        RETURN_STATUS status = OK;
+        if (!RayTable_Matches(
+                rays, camera_matrix, depth.cols, depth.rows, stride
+            )) {
+            status = RayTable_Init(
+                &rays, camera_matrix, depth.cols, depth.rows, stride
+            );
+        }
+        if (status == OK) {
+            status = backproject_depth(
+                rays, depth, rvec, tvec, points, image, &colors
+            );
+        }
+        if (status != OK) {
+            rr_log_message(
+                points_log_path,
+                "Back-projection failed",
+                rec,
+                rerun::TextLogLevel::Error
+            );
+        } else {
+            rr_log_points3d(points_log_path, points, colors, rec, lod);
+            rr_log_transform3d(
+                points_log_path, rfu_to_rub, {1.0f, 1.0f, 1.0f}, rec
+            );
+        }
+    }
+
     // Log camera intrinsics as a pinhole camera frustum.  Contains image above.
     auto focal_length = rerun::Vec2D{
         static_cast<float>(camera_matrix(0, 0)),
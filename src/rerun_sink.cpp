@@ -0,0 +1,185 @@
+#include "rerun_sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+/* Shortest reporting window */
+#define SINK_STATS_MIN_WINDOW_MS 1000
+
+RerunSinkConfig RerunSink_Default() {
+    RerunSinkConfig cfg = {};
+    cfg.kind = SINK_VIEWER;
+    cfg.viewer_addr = "127.0.0.1:9876";
+    cfg.file_path = "";
+    cfg.flush_bytes = -1;
+    cfg.flush_rows = -1;
+    cfg.flush_ms = -1.0;
+    cfg.report_stats = false;
+    return cfg;
+}
+
+RETURN_STATUS RerunSink_Parse(const std::string& spec, RerunSinkConfig* cfg) {
+    if (spec == "viewer") {
+        cfg->kind = SINK_VIEWER;
+        return OK;
+    }
+    if (spec.rfind("viewer:", 0) == 0 && spec.size() > 7) {
+        cfg->kind = SINK_VIEWER;
+        cfg->viewer_addr = spec.substr(7);
+        return OK;
+    }
+    if (spec.rfind("file:", 0) == 0 && spec.size() > 5) {
+        cfg->kind = SINK_FILE;
+        cfg->file_path = spec.substr(5);
+        return OK;
+    }
+    fprintf(stderr, "Unknown sink: %s\n", spec.c_str());
+    return ERROR;
+}
+
+std::string RerunSink_Describe(const RerunSinkConfig& cfg) {
+    if (cfg.kind == SINK_FILE) {
+        return "file:" + cfg.file_path;
+    }
+    return "viewer:" + cfg.viewer_addr;
+}
+
+static RETURN_STATUS set_env(const char* name, const char* value) {
+    if (setenv(name, value, 1) != 0) {
+        fprintf(stderr, "Failed to set %s: %s\n", name, strerror(errno));
+        return ERROR;
+    }
+    printf("%s=%s\n", name, value);
+    return OK;
+}
+
+RETURN_STATUS RerunSink_ApplyBatching(const RerunSinkConfig& cfg) {
+    char value[32];
+    if (cfg.flush_bytes >= 0) {
+        snprintf(value, sizeof(value), "%lld", (long long)cfg.flush_bytes);
+        if (set_env("RERUN_FLUSH_NUM_BYTES", value) != OK) {
+            return ERROR;
+        }
+    }
+    if (cfg.flush_rows >= 0) {
+        snprintf(value, sizeof(value), "%lld", (long long)cfg.flush_rows);
+        if (set_env("RERUN_FLUSH_NUM_ROWS", value) != OK) {
+            return ERROR;
+        }
+    }
+    if (cfg.flush_ms >= 0.0) {
+        snprintf(value, sizeof(value), "%.6f", cfg.flush_ms / 1000.0);
+        if (set_env("RERUN_FLUSH_TICK_SECS", value) != OK) {
+            return ERROR;
+        }
+    }
+    return OK;
+}
+
+RETURN_STATUS RerunSink_Open(
+    const RerunSinkConfig& cfg, const rerun::RecordingStream& rec
+) {
+    if (cfg.kind == SINK_FILE) {
+        rerun::Error err = rec.save(cfg.file_path);
+        if (err.is_err()) {
+            fprintf(
+                stderr,
+                "Failed to record to %s: %s\n",
+                cfg.file_path.c_str(),
+                err.description.c_str()
+            );
+            return ERROR;
+        }
+        printf("Recording to %s\n", cfg.file_path.c_str());
+        return OK;
+    }
+    if (!rec.connect_tcp(cfg.viewer_addr).is_ok()) {
+        fprintf(stderr, "Failed to spawn Rerun\n");
+        return ERROR;
+    }
+    printf("Connected to %s\n", cfg.viewer_addr.c_str());
+    return OK;
+}
+
+static uintmax_t sink_file_bytes(const RerunSinkStats& stats) {
+    if (stats.kind != SINK_FILE) {
+        return 0;
+    }
+    std::error_code ec;
+    uintmax_t bytes = std::filesystem::file_size(stats.file_path, ec);
+    return ec ? 0 : bytes;
+}
+
+void RerunSinkStats_Init(RerunSinkStats* stats, const RerunSinkConfig& cfg) {
+    stats->kind = cfg.kind;
+    stats->file_path = cfg.file_path;
+    stats->window = std::chrono::milliseconds(SINK_STATS_MIN_WINDOW_MS);
+    if (cfg.flush_ms > SINK_STATS_MIN_WINDOW_MS) {
+        stats->window = std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(cfg.flush_ms)
+        );
+    }
+    stats->window_start = std::chrono::steady_clock::now();
+    stats->window_start_bytes = sink_file_bytes(*stats);
+    stats->log_calls = 0;
+    stats->log_time = std::chrono::steady_clock::duration::zero();
+}
+
+void RerunSinkStats_AddLog(
+    RerunSinkStats* stats, std::chrono::steady_clock::duration elapsed
+) {
+    stats->log_calls += 1;
+    stats->log_time += elapsed;
+}
+
+void RerunSinkStats_Report(
+    RerunSinkStats* stats, const rerun::RecordingStream& rec
+) {
+    auto now = std::chrono::steady_clock::now();
+    if (now - stats->window_start < stats->window) {
+        return;
+    }
+
+    auto flush_start = std::chrono::steady_clock::now();
+    rec.flush_blocking();
+    auto flush_end = std::chrono::steady_clock::now();
+
+    double window_s =
+        std::chrono::duration<double>(flush_end - stats->window_start).count();
+    double flush_ms =
+        std::chrono::duration<double, std::milli>(flush_end - flush_start)
+            .count();
+    double log_ms =
+        stats->log_calls > 0
+            ? std::chrono::duration<double, std::milli>(stats->log_time)
+                      .count() /
+                  stats->log_calls
+            : 0.0;
+    if (stats->kind == SINK_FILE) {
+        uintmax_t bytes = sink_file_bytes(*stats);
+        uintmax_t written = bytes - std::min(bytes, stats->window_start_bytes);
+        printf(
+            "Sink %s: %8.3f MiB/s, log %8.4fms/call, flush latency %8.3fms\n",
+            stats->file_path.c_str(),
+            written / (1024.0 * 1024.0) / window_s,
+            log_ms,
+            flush_ms
+        );
+        stats->window_start_bytes = bytes;
+    } else {
+        printf(
+            "Sink viewer: log %8.4fms/call, flush latency %8.3fms\n",
+            log_ms,
+            flush_ms
+        );
+    }
+
+    stats->window_start = flush_end;
+    stats->log_calls = 0;
+    stats->log_time = std::chrono::steady_clock::duration::zero();
+}
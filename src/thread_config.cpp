@@ -0,0 +1,254 @@
+#include "thread_config.hpp"
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+ThreadConfig ThreadConfig_Default() {
+    ThreadConfig cfg = {};
+    cfg.numa_node = -1;
+    cfg.nice = 0;
+    cfg.sched_policy = SCHED_OTHER;
+    cfg.sched_priority = 0;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cfg.process_cpus.push_back(cpu);
+            }
+        }
+    }
+    return cfg;
+}
+
+bool parse_cpu_list(const std::string& list, std::vector<int>& cpus) {
+    cpus.clear();
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        int first = 0;
+        int last = 0;
+        char trailing = 0;
+        int n = sscanf(range.c_str(), "%d-%d%c", &first, &last, &trailing);
+        if (n == 1) {
+            last = first;
+        } else if (n != 2) {
+            return false;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return "any";
+    }
+    std::stringstream ss;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        ss << (i > 0 ? "," : "") << cpus[i];
+        if (j > i) {
+            ss << "-" << cpus[j];
+        }
+        i = j;
+    }
+    return ss.str();
+}
+
+int parse_sched_policy(const std::string& policy) {
+    if (policy == "other") {
+        return SCHED_OTHER;
+    } else if (policy == "batch") {
+        return SCHED_BATCH;
+    } else if (policy == "idle") {
+        return SCHED_IDLE;
+    } else if (policy == "fifo") {
+        return SCHED_FIFO;
+    } else if (policy == "rr") {
+        return SCHED_RR;
+    }
+    return -1;
+}
+
+/* CPUs belonging to a NUMA node, from sysfs */
+static bool numa_node_cpus(int node, std::vector<int>& cpus) {
+    char path[64];
+    snprintf(
+        path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node
+    );
+    std::ifstream file(path);
+    std::string list;
+    if (!file || !std::getline(file, list)) {
+        return false;
+    }
+    return parse_cpu_list(list, cpus);
+}
+
+/* NUMA node a CPU belongs to, or -1 if the system does not report one */
+static int cpu_numa_node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) == 0) {
+            return atoi(name.c_str() + 4);
+        }
+    }
+    return -1;
+}
+
+RETURN_STATUS ThreadConfig_Resolve(ThreadConfig& cfg) {
+    if (cfg.numa_node < 0) {
+        return OK;
+    }
+    std::vector<int> node_cpus;
+    if (!numa_node_cpus(cfg.numa_node, node_cpus)) {
+        fprintf(stderr, "NUMA node %d not found\n", cfg.numa_node);
+        return ERROR;
+    }
+    for (std::vector<int>* cpus : {&cfg.loader_cpus, &cfg.consumer_cpus}) {
+        if (cpus->empty()) {
+            *cpus = node_cpus;
+            continue;
+        }
+        std::vector<int> restricted;
+        std::set_intersection(
+            cpus->begin(),
+            cpus->end(),
+            node_cpus.begin(),
+            node_cpus.end(),
+            std::back_inserter(restricted)
+        );
+        if (restricted.empty()) {
+            fprintf(
+                stderr,
+                "CPUs %s are not on NUMA node %d\n",
+                format_cpu_list(*cpus).c_str(),
+                cfg.numa_node
+            );
+            return ERROR;
+        }
+        *cpus = restricted;
+    }
+    return OK;
+}
+
+int ThreadConfig_MemoryNode(const ThreadConfig& cfg) {
+    if (cfg.numa_node >= 0) {
+        return cfg.numa_node;
+    }
+    if (!cfg.consumer_cpus.empty()) {
+        return cpu_numa_node(cfg.consumer_cpus[0]);
+    }
+    return -1;
+}
+
+RETURN_STATUS ThreadConfig_PreferNode(int node) {
+    const size_t bits = 8 * sizeof(unsigned long);
+    if (node < 0 || node >= 1024) {
+        return ERROR;
+    }
+    unsigned long mask[1024 / bits] = {};
+    mask[node / bits] = 1UL << (node % bits);
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, 1024) != 0) {
+        fprintf(stderr, "set_mempolicy failed: %s\n", strerror(errno));
+        return ERROR;
+    }
+    return OK;
+}
+
+RETURN_STATUS ThreadConfig_Apply(
+    const ThreadConfig& cfg, const char* name, const std::vector<int>& cpus
+) {
+    RETURN_STATUS status = OK;
+    pthread_t self = pthread_self();
+
+    char short_name[16] = {0};
+    if (name != nullptr) {
+        strncpy(short_name, name, sizeof(short_name) - 1);
+        pthread_setname_np(self, short_name);
+    } else {
+        pthread_getname_np(self, short_name, sizeof(short_name));
+    }
+
+    /* Threads inherit their creator's mask, so an empty set is applied as the
+     * process's original one
+     */
+    const std::vector<int>& allowed = cpus.empty() ? cfg.process_cpus : cpus;
+    if (!allowed.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : allowed) {
+            CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (err != 0) {
+            fprintf(
+                stderr,
+                "%s: failed to pin to CPUs %s: %s\n",
+                short_name,
+                format_cpu_list(allowed).c_str(),
+                strerror(err)
+            );
+            status = ERROR;
+        }
+    }
+
+    sched_param param = {};
+    bool realtime =
+        cfg.sched_policy == SCHED_FIFO || cfg.sched_policy == SCHED_RR;
+    param.sched_priority = realtime ? cfg.sched_priority : 0;
+    /* Also set for SCHED_OTHER, which replaces any inherited policy */
+    int err = pthread_setschedparam(self, cfg.sched_policy, &param);
+    if (err != 0) {
+        fprintf(
+            stderr,
+            "%s: failed to set scheduling policy: %s\n",
+            short_name,
+            strerror(err)
+        );
+        status = ERROR;
+    }
+    /* Linux applies nice per thread when given a thread id */
+    if (!realtime && cfg.nice != 0) {
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        if (setpriority(PRIO_PROCESS, tid, cfg.nice) != 0) {
+            fprintf(
+                stderr,
+                "%s: failed to set nice %d: %s\n",
+                short_name,
+                cfg.nice,
+                strerror(errno)
+            );
+            status = ERROR;
+        }
+    }
+    return status;
+}
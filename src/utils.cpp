@@ -3,6 +3,8 @@
 #include <fstream>
 #include <sstream>
 
+#include "frame_bus.hpp"
+
 void help() {
     printf(
         "Usage: measure [OPTIONS]\n"
@@ -10,7 +12,37 @@ void help() {
         "  --enable_rerun    {true, false}. Default is true.\n"
         "  --viewer_addr     IP:PORT for rerun viewer. Default is "
         "127.0.0.1:9876.\n"
+        "  --sink            {viewer, viewer:IP:PORT, file:<path>}. Stream to "
+        "a viewer or record to an .rrd file. Default is viewer.\n"
+        "  --flush_bytes     Flush a logged chunk at this many bytes. Default "
+        "is the SDK's.\n"
+        "  --flush_rows      Flush a logged chunk at this many rows. Default "
+        "is the SDK's.\n"
+        "  --flush_ms        Flush logged chunks at least this often. Default "
+        "is the SDK's.\n"
+        "  --sink_stats      {true, false}. Print sink throughput and flush "
+        "latency about once a second. Forces a flush each time. Default is "
+        "false.\n"
         "  --threads         Number of image loader threads. Default is 3.\n"
+        "  --loader_cpus     CPU list for loader threads, e.g. 2-5,8.\n"
+        "  --consumer_cpus   CPU list for the consumer (main) thread.\n"
+        "  --numa_node       Bind threads and frame memory to a NUMA node.\n"
+        "  --nice            Nice value for pipeline threads. Default is 0.\n"
+        "  --sched           {other, batch, idle, fifo, rr}. Default is "
+        "other.\n"
+        "  --sched_prio      Priority for fifo/rr scheduling.\n"
+        "  --decode          {color, gray}. Default is color.\n"
+        "  --reduce          {1, 2, 4, 8}. Decode at 1/N resolution. Default "
+        "is 1.\n"
+        "  --shm_name        Publish frames to POSIX shared memory, e.g. "
+        "/mve_frames.\n"
+        "  --shm_slots       Frame slots in shared memory. Default is 8.\n"
+        "  --ready_frames    Frames decoded before playback starts. Default "
+        "is 0 (full buffer).\n"
+        "  --resident_mb     Replay from memory if the decoded dataset fits in "
+        "this many MiB. Default is 0 (always stream).\n"
+        "  --skip_unchanged  {true, false}. Skip logging frames identical to "
+        "the last one. Default is false.\n"
         //"  --path        Path to images directory\n"
     );
 }
@@ -20,8 +52,15 @@ std::pair<Cli, RETURN_STATUS> parseArgs(int argc, char** argv) {
     Cli cli = {};
     cli.threads = 3;
     cli.enable_rerun = true;
-    cli.viewer_addr = "127.0.0.1:9876";
+    cli.sink = RerunSink_Default();
     cli.path = "";
+    cli.decode = DECODE_COLOR;
+    cli.shm_name = "";
+    cli.shm_slots = 8;
+    cli.ready_frames = 0;
+    cli.resident_mb = 0;
+    cli.skip_unchanged = false;
+    cli.thread_config = ThreadConfig_Default();
     for (size_t i = 1; i < (size_t)argc; ++i) {
         std::string arg(argv[i]);
         if (arg == "-h" || arg == "--help") {
@@ -48,17 +87,178 @@ std::pair<Cli, RETURN_STATUS> parseArgs(int argc, char** argv) {
             continue;
         }
         if (std::string(argv[i]) == "--viewer_addr" && i + 1 < (size_t)argc) {
-            cli.viewer_addr = argv[i + 1];
+            cli.sink.viewer_addr = argv[i + 1];
             printf(
                 "CLI OPTION SET: Rerun viewer IP:PORT = %s\n",
-                cli.viewer_addr.c_str()
+                cli.sink.viewer_addr.c_str()
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--sink" && i + 1 < (size_t)argc) {
+            if (RerunSink_Parse(argv[i + 1], &cli.sink) != OK) {
+                return std::pair(cli, ERROR);
+            }
+            printf(
+                "CLI OPTION SET: Rerun sink = %s\n",
+                RerunSink_Describe(cli.sink).c_str()
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--flush_bytes" && i + 1 < (size_t)argc) {
+            cli.sink.flush_bytes = atoll(argv[i + 1]);
+            printf(
+                "CLI OPTION SET: Flush bytes = %lld\n",
+                (long long)cli.sink.flush_bytes
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--flush_rows" && i + 1 < (size_t)argc) {
+            cli.sink.flush_rows = atoll(argv[i + 1]);
+            printf(
+                "CLI OPTION SET: Flush rows = %lld\n",
+                (long long)cli.sink.flush_rows
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--flush_ms" && i + 1 < (size_t)argc) {
+            cli.sink.flush_ms = atof(argv[i + 1]);
+            printf(
+                "CLI OPTION SET: Flush interval = %gms\n", cli.sink.flush_ms
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--sink_stats" && i + 1 < (size_t)argc) {
+            std::string stats_str = argv[i + 1];
+            for (auto& c : stats_str) {
+                c = tolower(c);
+            }
+            cli.sink.report_stats = stats_str == "true" || stats_str == "1";
+            printf(
+                "CLI OPTION SET: Sink stats = %s\n",
+                cli.sink.report_stats ? "true" : "false"
             );
             continue;
         }
         if (std::string(argv[i]) == "--threads" && i + 1 < (size_t)argc) {
             cli.threads = atoi(argv[i + 1]);
+            printf("CLI OPTION SET: Loader threads = %zu\n", cli.threads);
+            continue;
+        }
+        if ((std::string(argv[i]) == "--loader_cpus" ||
+             std::string(argv[i]) == "--consumer_cpus") &&
+            i + 1 < (size_t)argc) {
+            bool loader = std::string(argv[i]) == "--loader_cpus";
+            std::vector<int>& cpus = loader ? cli.thread_config.loader_cpus
+                                            : cli.thread_config.consumer_cpus;
+            if (!parse_cpu_list(argv[i + 1], cpus)) {
+                fprintf(stderr, "Invalid CPU list: %s\n", argv[i + 1]);
+                return std::pair(cli, ERROR);
+            }
+            printf(
+                "CLI OPTION SET: %s CPUs = %s\n",
+                loader ? "Loader" : "Consumer",
+                format_cpu_list(cpus).c_str()
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--numa_node" && i + 1 < (size_t)argc) {
+            cli.thread_config.numa_node = atoi(argv[i + 1]);
+            printf(
+                "CLI OPTION SET: NUMA node = %d\n", cli.thread_config.numa_node
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--nice" && i + 1 < (size_t)argc) {
+            cli.thread_config.nice = atoi(argv[i + 1]);
+            printf("CLI OPTION SET: Nice = %d\n", cli.thread_config.nice);
+            continue;
+        }
+        if (std::string(argv[i]) == "--sched" && i + 1 < (size_t)argc) {
+            std::string sched_str = argv[i + 1];
+            for (auto& c : sched_str) {
+                c = tolower(c);
+            }
+            cli.thread_config.sched_policy = parse_sched_policy(sched_str);
+            if (cli.thread_config.sched_policy < 0) {
+                fprintf(stderr, "Unknown scheduling policy: %s\n", argv[i + 1]);
+                return std::pair(cli, ERROR);
+            }
             printf(
-                "CLI OPTION SET: Rerun viewer IP:PORT = %s\n", cli.path.c_str()
+                "CLI OPTION SET: Scheduling policy = %s\n", sched_str.c_str()
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--sched_prio" && i + 1 < (size_t)argc) {
+            cli.thread_config.sched_priority = atoi(argv[i + 1]);
+            printf(
+                "CLI OPTION SET: Scheduling priority = %d\n",
+                cli.thread_config.sched_priority
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--decode" && i + 1 < (size_t)argc) {
+            std::string decode_str = argv[i + 1];
+            for (auto& c : decode_str) {
+                c = tolower(c);
+            }
+            if (decode_str == "gray" || decode_str == "grayscale") {
+                cli.decode.grayscale = true;
+            } else if (decode_str == "color") {
+                cli.decode.grayscale = false;
+            } else {
+                fprintf(stderr, "Unknown decode mode: %s\n", argv[i + 1]);
+                return std::pair(cli, ERROR);
+            }
+            printf(
+                "CLI OPTION SET: Decode mode = %s\n",
+                cli.decode.grayscale ? "gray" : "color"
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--reduce" && i + 1 < (size_t)argc) {
+            cli.decode.reduce = atoi(argv[i + 1]);
+            if (!DecodeProfile_IsValid(cli.decode)) {
+                fprintf(stderr, "Unsupported reduce factor: %s\n", argv[i + 1]);
+                return std::pair(cli, ERROR);
+            }
+            printf("CLI OPTION SET: Decode reduce = 1/%u\n", cli.decode.reduce);
+            continue;
+        }
+        if (std::string(argv[i]) == "--shm_name" && i + 1 < (size_t)argc) {
+            cli.shm_name = argv[i + 1];
+            printf(
+                "CLI OPTION SET: Shared memory name = %s\n",
+                cli.shm_name.c_str()
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--shm_slots" && i + 1 < (size_t)argc) {
+            cli.shm_slots = atoi(argv[i + 1]);
+            printf("CLI OPTION SET: Shared memory slots = %u\n", cli.shm_slots);
+            continue;
+        }
+        if (std::string(argv[i]) == "--ready_frames" && i + 1 < (size_t)argc) {
+            cli.ready_frames = atoi(argv[i + 1]);
+            printf("CLI OPTION SET: Ready frames = %u\n", cli.ready_frames);
+            continue;
+        }
+        if (std::string(argv[i]) == "--resident_mb" && i + 1 < (size_t)argc) {
+            cli.resident_mb = atoi(argv[i + 1]);
+            printf(
+                "CLI OPTION SET: Resident budget = %zuMiB\n", cli.resident_mb
+            );
+            continue;
+        }
+        if (std::string(argv[i]) == "--skip_unchanged" &&
+            i + 1 < (size_t)argc) {
+            std::string skip_str = argv[i + 1];
+            for (auto& c : skip_str) {
+                c = tolower(c);
+            }
+            cli.skip_unchanged = skip_str == "true" || skip_str == "1";
+            printf(
+                "CLI OPTION SET: Skip unchanged frames = %s\n",
+                cli.skip_unchanged ? "true" : "false"
             );
             continue;
         }
@@ -66,30 +266,163 @@ std::pair<Cli, RETURN_STATUS> parseArgs(int argc, char** argv) {
     return std::pair(cli, OK);
 }
 
+/* Copy a consumed frame to the shared memory bus, sizing the bus from the
+ * first frame.  Only the consumer calls this, in playback order and outside
+ * `producer_mutex`.
+ */
+static void publish_frame(ImageBuffer* buf, const cv::Mat& img) {
+    if (buf->bus_name.empty()) {
+        return;
+    }
+    if (buf->bus == nullptr) {
+        FrameBus* bus = new FrameBus();
+        if (FrameBus_Create(
+                bus, buf->bus_name, buf->bus_slots, img.total() * img.elemSize()
+            ) != OK) {
+            fprintf(stderr, "WARN: Frame bus disabled\n");
+            delete bus;
+            buf->bus_name.clear();
+            return;
+        }
+        printf(
+            "Publishing frames to %s (%u slots)\n",
+            buf->bus_name.c_str(),
+            buf->bus_slots
+        );
+        buf->bus = bus;
+    }
+    /* Slots are sized from the first frame, so a larger frame in a mixed
+     * dataset can't be published.  Stop at the first one rather than failing
+     * on every frame; the segment stays mapped until shutdown.
+     */
+    if (FrameBus_Publish(buf->bus, img) != OK) {
+        fprintf(stderr, "WARN: Frame bus disabled\n");
+        buf->bus_name.clear();
+    }
+}
+
+/* Share of the initial fill.  Slots are claimed in order and decoded in
+ * parallel; whichever loader completes the next slot in sequence hands the
+ * contiguous run to the consumer and fires readiness.  Resident frames stay in
+ * `images`.
+ */
+static void warmup_image_loader(ImageBuffer* buf) {
+    while (!buf->shutdown) {
+        uint32_t slot = buf->warm_next.fetch_add(1);
+        if (slot >= buf->buffer_size) {
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+        const fs::path& image_path =
+            buf->image_paths[slot % buf->image_paths.size()];
+        buf->images[slot] = cv::imread(image_path, buf->imread_flags);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (buf->images[slot].empty()) {
+            fprintf(stderr, "Failed to decode %s\n", image_path.c_str());
+        }
+        buf->warm_decode_us.fetch_add(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                .count()
+        );
+
+        std::lock_guard<std::mutex> lock(buf->producer_mutex);
+        buf->warm_decoded[slot] = true;
+        while (buf->warm_prefix < buf->buffer_size &&
+               buf->warm_decoded[buf->warm_prefix]) {
+            cv::Mat& img = buf->images[buf->warm_prefix];
+            /* Frames that failed to decode are dropped */
+            if (!img.empty() && buf->resident) {
+                /* Close the gaps left by dropped frames.  Slots below
+                 * `warm_prefix` are no longer written by loaders.
+                 */
+                uint32_t loaded = buf->loaded_count.load();
+                if (loaded != buf->warm_prefix) {
+                    buf->images[loaded] = std::move(img);
+                }
+                buf->loaded_count.store(loaded + 1);
+            } else if (!img.empty()) {
+                /* The ring has capacity for the whole initial fill */
+                buf->ring.try_push(std::move(img));
+            }
+            buf->warm_prefix += 1;
+        }
+        if (!buf->ready_fired && buf->warm_prefix >= buf->ready_frames) {
+            buf->ready_fired = true;
+            buf->ready_promise.set_value();
+        }
+        if (buf->warm_prefix == buf->buffer_size) {
+            buf->warm_complete.store(true);
+            buf->producer_cv.notify_all();
+        }
+    }
+}
+
 void background_image_loader(ImageBuffer* buf, uint32_t loader_idx) {
+    char thread_name[16];
+    snprintf(thread_name, sizeof(thread_name), "mve-loader-%u", loader_idx);
+    ThreadConfig cfg =
+        buf->has_thread_config ? buf->thread_config : ThreadConfig_Default();
+    ThreadConfig_Apply(cfg, thread_name, cfg.loader_cpus);
+    /* Decoded frames are read by the consumer; place them on its node */
+    int memory_node = ThreadConfig_MemoryNode(cfg);
+    if (memory_node >= 0) {
+        ThreadConfig_PreferNode(memory_node);
+    }
+
+    warmup_image_loader(buf);
+    if (buf->resident) {
+        return;
+    }
+
     std::stringstream fname;
     fname << "loader_" << loader_idx << ".csv";
     std::fstream loader_file(
         fname.str(), std::ios::in | std::ios::out | std::ios::trunc
     );
-    loader_file << "path_name,path_idx,tail_idx,loaded_count\n";
-    while (!buf->shutdown) {
-        uint32_t loaded_count = buf->loaded_count.load();
-        uint32_t active_loader_idx = buf->active_loader_idx.load();
-        if (loaded_count < buf->buffer_size &&
-            active_loader_idx == loader_idx) {
-            uint32_t tail_idx = buf->tail_idx.load();
-            uint32_t path_idx = buf->path_idx.load();
-            uint32_t loaded_count = buf->path_idx.load();
-
-            fs::path image_path = buf->image_paths[buf->path_idx];
-            buf->images[tail_idx] = cv::imread(image_path);
-            buf->path_idx.store((path_idx + 1) % buf->image_paths.size());
-            buf->tail_idx.store((tail_idx + 1) % buf->buffer_size);
-            buf->loaded_count.fetch_add(1);
-            loader_file << image_path << "," << path_idx << "," << tail_idx
-                        << "," << loaded_count << "\n";
+    loader_file << "path_name,path_idx,ring_size\n";
+    while (true) {
+        /* Claim the next frame in sequence, if the ring has room for it once
+         * every frame already claimed lands
+         */
+        std::unique_lock<std::mutex> lock(buf->producer_mutex);
+        buf->producer_cv.wait(lock, [&] {
+            return buf->shutdown ||
+                   (buf->warm_complete &&
+                    buf->stream_next - buf->stream_prefix + buf->ring.size() <
+                        buf->buffer_size);
+        });
+        if (buf->shutdown) {
+            break;
+        }
+        uint64_t seq = buf->stream_next++;
+        uint32_t path_idx = buf->path_idx.load();
+        buf->path_idx.store((path_idx + 1) % buf->image_paths.size());
+        lock.unlock();
+
+        /* Decode in parallel with the other loaders */
+        const fs::path& image_path = buf->image_paths[path_idx];
+        cv::Mat img = cv::imread(image_path, buf->imread_flags);
+        if (img.empty()) {
+            fprintf(stderr, "Failed to decode %s\n", image_path.c_str());
+        }
+
+        lock.lock();
+        buf->images[seq % buf->buffer_size] = std::move(img);
+        buf->stream_decoded[seq % buf->buffer_size] = true;
+        /* Hand over the contiguous run of decoded frames, in sequence order */
+        while (buf->stream_decoded[buf->stream_prefix % buf->buffer_size]) {
+            size_t staged = buf->stream_prefix % buf->buffer_size;
+            /* Frames that failed to decode are dropped */
+            if (!buf->images[staged].empty()) {
+                cv::Mat* slot = buf->ring.claim();
+                *slot = std::move(buf->images[staged]);
+                buf->ring.publish();
+            }
+            buf->stream_decoded[staged] = false;
+            buf->stream_prefix += 1;
         }
+        loader_file << image_path << "," << path_idx << ","
+                    << buf->ring.size() << "\n";
     }
 }
 
@@ -97,18 +430,63 @@ RETURN_STATUS ImageBuffer_Init(
     ImageBuffer* buffer,
     std::string path,
     uint32_t buffer_size,
-    uint32_t n_loaders
+    uint32_t n_loaders,
+    DecodeProfile profile,
+    uint32_t ready_frames
 ) {
     fs::path image_dir = path;
     if (!fs::is_directory(image_dir)) {
         fprintf(stderr, "Path is not a directory: %s\n", path.c_str());
         return ERROR;
     }
+    if (!DecodeProfile_IsValid(profile)) {
+        fprintf(stderr, "Invalid decode reduce factor: %u\n", profile.reduce);
+        return ERROR;
+    }
+    buffer->profile = profile;
+    buffer->imread_flags = DecodeProfile_ImreadFlags(profile);
 
     buffer->image_paths.clear();
     for (const auto& entry : fs::directory_iterator(image_dir)) {
-        if (fs::is_regular_file(entry) && entry.path().extension() == ".png") {
-            buffer->image_paths.push_back(entry.path());
+        if (!fs::is_regular_file(entry) || !is_image_file(entry.path())) {
+            continue;
+        }
+        /* Checks the file's signature, e.g. a GIF without a GIF decoder */
+        if (!cv::haveImageReader(entry.path())) {
+            fprintf(
+                stderr,
+                "WARN: Skipping %s, which OpenCV can't decode\n",
+                entry.path().c_str()
+            );
+            continue;
+        }
+        buffer->image_paths.push_back(entry.path());
+    }
+
+    std::sort(buffer->image_paths.begin(), buffer->image_paths.end());
+
+    buffer->resident = false;
+    if (buffer->resident_budget > 0 && !buffer->image_paths.empty()) {
+        /* Frames in a dataset share a shape, so one decode sizes them all */
+        cv::Mat probe =
+            cv::imread(buffer->image_paths[0], buffer->imread_flags);
+        size_t total_bytes =
+            probe.total() * probe.elemSize() * buffer->image_paths.size();
+        if (!probe.empty() && total_bytes <= buffer->resident_budget) {
+            buffer->resident = true;
+            buffer_size = buffer->image_paths.size();
+            printf(
+                "Resident mode: %zu images, %.1fMiB decoded\n",
+                buffer->image_paths.size(),
+                total_bytes / (1024.0 * 1024.0)
+            );
+        } else {
+            printf(
+                "Dataset needs %.1fMiB decoded, over resident budget of "
+                "%.1fMiB.  Streaming instead.\n",
+                total_bytes / (1024.0 * 1024.0),
+                buffer->resident_budget / (1024.0 * 1024.0)
+            );
         }
     }
 
@@ -121,32 +499,48 @@ RETURN_STATUS ImageBuffer_Init(
             buffer_size
         );
     }
-    std::sort(buffer->image_paths.begin(), buffer->image_paths.end());
+    if (buffer_size == 0) {
+        fprintf(stderr, "No images found in %s\n", path.c_str());
+        return ERROR;
+    }
+
+    if (n_loaders == 0) {
+        n_loaders = 1;
+        fprintf(stderr, "WARN: At least one loader is required\n");
+    }
+    if (!buffer->resident) {
+        /* Capacity may round up, but loaders never hold more than
+         * `buffer_size` frames in the ring, and consumed slots are emptied
+         */
+        buffer->ring.reset(buffer_size);
+    }
+    if (ready_frames == 0 || ready_frames > buffer_size) {
+        ready_frames = buffer_size;
+    }
 
+    buffer->images.clear();
     buffer->images.resize(buffer_size);
     buffer->buffer_size = buffer_size;
-    std::vector<std::chrono::high_resolution_clock::time_point[2]>
-        avg_load_times(buffer->buffer_size);
-    /* Pre-load buffer with images */
-    for (size_t i = 0; i < buffer->buffer_size; ++i) {
-        avg_load_times[i][0] = std::chrono::high_resolution_clock::now();
-        buffer->images[i] = cv::imread(buffer->image_paths[i]);
-        avg_load_times[i][1] = std::chrono::high_resolution_clock::now();
-    }
-    double sum = 0.0;
-    for (size_t i = 0; i < buffer->buffer_size; ++i) {
-        auto duration = avg_load_times[i][1] - avg_load_times[i][0];
-        sum += std::chrono::duration_cast<std::chrono::milliseconds>(duration)
-                   .count();
-    }
-    printf("Avg load time: %10.4fms\n", sum / buffer->buffer_size);
-    buffer->tail_idx.store(0);
-    buffer->loaded_count.store(buffer_size);
-    buffer->path_idx.store(buffer_size);
+    buffer->loaded_count.store(0);
+    buffer->path_idx.store(buffer_size % buffer->image_paths.size());
     buffer->head_idx.store(0);
     buffer->shutdown.store(false);
 
-    buffer->active_loader_idx.store(0);
+    buffer->warm_next.store(0);
+    buffer->warm_decoded.assign(buffer_size, false);
+    buffer->warm_prefix = 0;
+    buffer->warm_complete.store(false);
+    buffer->warm_decode_us.store(0);
+    buffer->ready_frames = ready_frames;
+    buffer->ready_fired = false;
+    buffer->ready_promise = std::promise<void>();
+    buffer->ready = buffer->ready_promise.get_future().share();
+
+    buffer->stream_next = 0;
+    buffer->stream_prefix = 0;
+    buffer->stream_decoded.assign(buffer_size, false);
+
+    /* Loaders split the initial fill, then stream in parallel */
     buffer->loader_threads_count.store(n_loaders);
     for (uint32_t i = 0; i < n_loaders; ++i) {
         buffer->loader_threads.emplace_back(
@@ -156,16 +550,69 @@ RETURN_STATUS ImageBuffer_Init(
     return OK;
 }
 
-RETURN_STATUS ImageBuffer_NextImage(const ImageBuffer& buf, cv::Mat& img) {
-    uint32_t loaded_count = buf.loaded_count.load();
-    if (loaded_count == 0) {
-        fprintf(stderr, "Attempt to get image from empty buffer\n");
+void ImageBuffer_PublishTo(
+    ImageBuffer* buffer, std::string shm_name, uint32_t slot_count
+) {
+    buffer->bus_name = shm_name;
+    buffer->bus_slots = slot_count;
+}
+
+void ImageBuffer_SetThreadConfig(ImageBuffer* buffer, const ThreadConfig& cfg) {
+    buffer->has_thread_config = true;
+    buffer->thread_config = cfg;
+}
+
+void ImageBuffer_AllowResident(ImageBuffer* buffer, size_t budget_bytes) {
+    buffer->resident_budget = budget_bytes;
+}
+
+RETURN_STATUS ImageBuffer_WaitReady(
+    const ImageBuffer& buf, std::chrono::milliseconds timeout
+) {
+    if (!buf.ready.valid()) {
+        fprintf(stderr, "Image buffer was not initialized\n");
         return ERROR;
     }
+    if (buf.ready.wait_for(timeout) != std::future_status::ready) {
+        fprintf(
+            stderr,
+            "Image buffer not ready after %ldms\n",
+            (long)timeout.count()
+        );
+        return ERROR;
+    }
+    return OK;
+}
 
+/* Resident playback position, wrapped once every frame has been decoded.
+ * Frames that failed to decode leave fewer than `buffer_size`.
+ */
+static uint32_t resident_head(const ImageBuffer& buf) {
     uint32_t head_idx = buf.head_idx.load();
-    cv::Mat src = buf.images[head_idx];
-    if (src.size != img.size && src.type() != img.type()) {
+    if (buf.warm_complete.load() && head_idx >= buf.loaded_count.load()) {
+        return 0;
+    }
+    return head_idx;
+}
+
+/* Frame at the head of the buffer, or nullptr if none is ready yet */
+static const cv::Mat* head_image(const ImageBuffer& buf) {
+    if (buf.resident) {
+        uint32_t head_idx = resident_head(buf);
+        return head_idx < buf.loaded_count.load() ? &buf.images[head_idx]
+                                                  : nullptr;
+    }
+    return buf.ring.front();
+}
+
+RETURN_STATUS ImageBuffer_NextImage(const ImageBuffer& buf, cv::Mat& img) {
+    const cv::Mat* head = head_image(buf);
+    if (head == nullptr) {
+        return EARLY_OUT;
+    }
+
+    const cv::Mat& src = *head;
+    if (src.size != img.size || src.type() != img.type()) {
         fprintf(stderr, "Image shape mismatch\n");
         return ERROR;
     }
@@ -173,40 +620,85 @@ RETURN_STATUS ImageBuffer_NextImage(const ImageBuffer& buf, cv::Mat& img) {
     return OK;
 }
 
+RETURN_STATUS ImageBuffer_PeekImage(const ImageBuffer& buf, cv::Mat& img) {
+    const cv::Mat* head = head_image(buf);
+    if (head == nullptr) {
+        return EARLY_OUT;
+    }
+    img = *head;
+    return OK;
+}
+
 RETURN_STATUS ImageBuffer_ConsumeImage(ImageBuffer& buf) {
-    uint32_t loaded_count = buf.loaded_count.load();
-    uint32_t active_loader_idx = buf.active_loader_idx.load();
-    if (loaded_count > 0) {
-        uint32_t head_idx = buf.head_idx.load();
-        buf.head_idx.store((head_idx + 1) % buf.buffer_size);
-        buf.loaded_count.fetch_sub(1);
-        buf.active_loader_idx.store(
-            (active_loader_idx + 1) % buf.loader_threads_count
-        );
-    } else {
+    const cv::Mat* head = head_image(buf);
+    if (head == nullptr) {
         fprintf(stderr, "Attempt to get image from empty buffer\n");
         return ERROR;
     }
+    /* Both modes publish as frames are played, so bus readers see the same
+     * timing either way
+     */
+    publish_frame(&buf, *head);
+    if (buf.resident) {
+        /* Replay is a walk over decoded frames; nothing is freed or loaded */
+        buf.head_idx.store(resident_head(buf) + 1);
+        return OK;
+    }
+
+    buf.ring.pop();
+    {
+        /* Loaders only decode outside the lock, so this never waits on one.
+         * Taking it keeps a loader from missing the wakeup between checking
+         * for room and waiting.
+         */
+        std::lock_guard<std::mutex> lock(buf.producer_mutex);
+    }
+    buf.producer_cv.notify_one();
     return OK;
 }
 
 RETURN_STATUS ImageBuffer_Shutdown(ImageBuffer& buf) {
-    buf.shutdown.store(true);
+    {
+        std::lock_guard<std::mutex> lock(buf.producer_mutex);
+        buf.shutdown.store(true);
+    }
+    buf.producer_cv.notify_all();
     for (uint32_t i = 0; i < buf.loader_threads.size(); ++i) {
         if (buf.loader_threads[i].joinable()) {
             buf.loader_threads[i].join();
         }
     }
+    if (buf.bus != nullptr) {
+        FrameBus_Destroy(buf.bus);
+        delete buf.bus;
+        buf.bus = nullptr;
+    }
     return OK;
 }
 
 void ImageBuffer_Stats(const ImageBuffer& buf) {
     printf("Image buffer size   : %d\n", buf.buffer_size);
+    printf("Resident            : %s\n", buf.resident ? "true" : "false");
     printf("Image paths count   : %ld\n", buf.image_paths.size());
-    printf("Head index          : %d\n", buf.head_idx.load());
-    printf("Tail index          : %d\n", buf.tail_idx.load());
-    printf("Current index       : %d\n", buf.path_idx.load());
-    printf("Loaded images count : %d\n\n", buf.loaded_count.load());
+    printf(
+        "Decode profile      : %s 1/%u\n",
+        buf.profile.grayscale ? "gray" : "color",
+        buf.profile.reduce
+    );
+    if (buf.resident) {
+        printf("Head index          : %d\n", buf.head_idx.load());
+        printf("Loaded images count : %d\n", buf.loaded_count.load());
+    } else {
+        printf("Ring capacity       : %zu\n", buf.ring.capacity());
+        printf("Current index       : %d\n", buf.path_idx.load());
+        /* Popped slots are released, so only queued frames are held */
+        printf("Loaded images count : %zu\n", buf.ring.size());
+    }
+    uint32_t warmed = std::min(buf.warm_next.load(), buf.buffer_size);
+    printf(
+        "Avg warmup decode   : %10.4fms\n\n",
+        warmed > 0 ? buf.warm_decode_us.load() / 1000.0 / warmed : 0.0
+    );
 }
 
 // Quick and dirty sanitizing
@@ -227,18 +719,54 @@ bool is_image_file(const fs::path& img_path) {
     return find(extensions.begin(), extensions.end(), ext) != extensions.end();
 }
 
+bool DecodeProfile_IsValid(const DecodeProfile& profile) {
+    return profile.reduce == 1 || profile.reduce == 2 || profile.reduce == 4 ||
+           profile.reduce == 8;
+}
+
+/* `IMREAD_REDUCED_*` lets libjpeg scale in the DCT domain, so a 1/N decode of
+ * a JPEG skips most of the IDCT work instead of resizing afterwards.
+ */
+int DecodeProfile_ImreadFlags(const DecodeProfile& profile) {
+    switch (profile.reduce) {
+        case 2:
+            return profile.grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2
+                                     : cv::IMREAD_REDUCED_COLOR_2;
+        case 4:
+            return profile.grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4
+                                     : cv::IMREAD_REDUCED_COLOR_4;
+        case 8:
+            return profile.grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8
+                                     : cv::IMREAD_REDUCED_COLOR_8;
+        default:
+            return profile.grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+    }
+}
+
 int load_saved_images(
     std::string rr_path,
     const fs::path img_path,
     std::vector<cv::Mat>& images,
-    const rerun::RecordingStream& rec
+    const rerun::RecordingStream& rec,
+    const DecodeProfile* profile
 ) {
     rr_path += "/load_saved_images";
+    int file_flags = profile ? DecodeProfile_ImreadFlags(*profile)
+                             : cv::IMREAD_GRAYSCALE;
+    int dir_flags =
+        profile ? DecodeProfile_ImreadFlags(*profile) : cv::IMREAD_COLOR;
     std::stringstream log_ss;
     if (fs::is_regular_file(img_path)) {
         if (is_image_file(img_path)) {
-            cv::Mat img = cv::imread(img_path, cv::IMREAD_GRAYSCALE);
-            images.push_back(img);
+            cv::Mat img = cv::imread(img_path, file_flags);
+            if (!img.empty()) {
+                images.push_back(img);
+            } else {
+                log_ss << "Failed to decode " << img_path;
+                rr_log_stream_and_clear(
+                    rr_path, log_ss, rec, rerun::TextLogLevel::Error
+                );
+            }
         } else {
             log_ss << "File is not recognized as an image: " << img_path;
             rr_log_stream_and_clear(
@@ -263,7 +791,14 @@ int load_saved_images(
             }
         );
         for (const auto& entry : paths) {
-            cv::Mat img = cv::imread(entry.path(), cv::IMREAD_COLOR);
+            cv::Mat img = cv::imread(entry.path(), dir_flags);
+            if (img.empty()) {
+                log_ss << "Failed to decode " << entry.path();
+                rr_log_stream_and_clear(
+                    rr_path, log_ss, rec, rerun::TextLogLevel::Error
+                );
+                continue;
+            }
             images.push_back(img);
         }
     } else {
@@ -0,0 +1,262 @@
+#include "voxel_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+/* Voxel coordinates are packed 21 bits per axis into a 64-bit key */
+#define VOXEL_COORD_BITS 21
+#define VOXEL_COORD_LIMIT (1 << (VOXEL_COORD_BITS - 1))
+/* Never produced by `voxel_key`, which uses only the low 63 bits */
+#define VOXEL_NO_KEY UINT64_MAX
+
+struct VoxelAccum {
+    double sum[3];
+    uint64_t color_sum[3];
+    uint32_t count;
+    /* Input index of the point nearest the voxel center so far */
+    uint32_t nearest;
+    float nearest_dist;
+};
+
+static inline uint64_t voxel_key(int x, int y, int z) {
+    const uint64_t mask = (1ULL << VOXEL_COORD_BITS) - 1;
+    uint64_t kx = (uint64_t)(x + VOXEL_COORD_LIMIT) & mask;
+    uint64_t ky = (uint64_t)(y + VOXEL_COORD_LIMIT) & mask;
+    uint64_t kz = (uint64_t)(z + VOXEL_COORD_LIMIT) & mask;
+    return kx | (ky << VOXEL_COORD_BITS) | (kz << (2 * VOXEL_COORD_BITS));
+}
+
+/* splitmix64 finalizer: spreads neighbouring voxel keys over the table */
+static inline uint64_t voxel_hash(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+static inline bool voxel_coord(float v, float inv_size, int* coord) {
+    float c = std::floor(v * inv_size);
+    /* Also false for NaN */
+    if (!(c >= -VOXEL_COORD_LIMIT && c < VOXEL_COORD_LIMIT)) {
+        return false;
+    }
+    *coord = static_cast<int>(c);
+    return true;
+}
+
+/* Accumulate one shard's points into per-voxel sums using an open-addressed
+ * table sized for the shard.
+ */
+static void accumulate_shard(
+    const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>* colors,
+    const std::vector<uint64_t>& keys,
+    const uint32_t* indices,
+    size_t count,
+    float voxel_size,
+    std::vector<VoxelAccum>& accums
+) {
+    accums.clear();
+    if (count == 0) {
+        return;
+    }
+    size_t capacity = 16;
+    while (capacity < 2 * count) {
+        capacity <<= 1;
+    }
+    const size_t mask = capacity - 1;
+    std::vector<uint64_t> table_keys(capacity, VOXEL_NO_KEY);
+    std::vector<uint32_t> table_slots(capacity);
+    const float inv_size = 1.0f / voxel_size;
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t idx = indices[i];
+        uint64_t key = keys[idx];
+        /* The low bits chose the shard, so probe with the high bits */
+        size_t pos = (voxel_hash(key) >> 32) & mask;
+        while (table_keys[pos] != key && table_keys[pos] != VOXEL_NO_KEY) {
+            pos = (pos + 1) & mask;
+        }
+        if (table_keys[pos] == VOXEL_NO_KEY) {
+            table_keys[pos] = key;
+            table_slots[pos] = static_cast<uint32_t>(accums.size());
+            VoxelAccum fresh = {};
+            fresh.nearest_dist = INFINITY;
+            accums.push_back(fresh);
+        }
+        VoxelAccum& acc = accums[table_slots[pos]];
+        const cv::Point3f& p = points[idx];
+        acc.sum[0] += p.x;
+        acc.sum[1] += p.y;
+        acc.sum[2] += p.z;
+        if (colors != nullptr) {
+            const cv::Vec3b& c = (*colors)[idx];
+            acc.color_sum[0] += c[0];
+            acc.color_sum[1] += c[1];
+            acc.color_sum[2] += c[2];
+        }
+        acc.count++;
+
+        float dx = p.x - (std::floor(p.x * inv_size) + 0.5f) * voxel_size;
+        float dy = p.y - (std::floor(p.y * inv_size) + 0.5f) * voxel_size;
+        float dz = p.z - (std::floor(p.z * inv_size) + 0.5f) * voxel_size;
+        float dist = dx * dx + dy * dy + dz * dz;
+        if (dist < acc.nearest_dist) {
+            acc.nearest_dist = dist;
+            acc.nearest = idx;
+        }
+    }
+}
+
+RETURN_STATUS voxel_downsample(
+    const std::vector<cv::Point3f>& points,
+    const std::vector<cv::Vec3b>* colors,
+    float voxel_size,
+    VoxelColorMode mode,
+    std::vector<cv::Point3f>& out_points,
+    std::vector<cv::Vec3b>* out_colors
+) {
+    if (!(voxel_size > 0.0f) || !std::isfinite(voxel_size)) {
+        fprintf(stderr, "Invalid voxel size %f\n", voxel_size);
+        return ERROR;
+    }
+    if (colors != nullptr && colors->size() != points.size()) {
+        fprintf(
+            stderr,
+            "Got %zu colors for %zu points\n",
+            colors->size(),
+            points.size()
+        );
+        return ERROR;
+    }
+    if (points.size() >= UINT32_MAX) {
+        fprintf(stderr, "Too many points to downsample: %zu\n", points.size());
+        return ERROR;
+    }
+    if (colors == nullptr) {
+        out_colors = nullptr;
+    }
+
+    const size_t n = points.size();
+    const int n_chunks = std::max(1, cv::getNumThreads() * 4);
+    const int n_shards = n_chunks;
+    const size_t chunk_size = (n + n_chunks - 1) / n_chunks;
+    const float inv_size = 1.0f / voxel_size;
+
+    /* Pass 1: voxel key per point, and how many points each chunk sends to
+     * each shard
+     */
+    std::vector<uint64_t> keys(n);
+    std::vector<size_t> counts((size_t)n_chunks * n_shards, 0);
+    cv::parallel_for_(cv::Range(0, n_chunks), [&](const cv::Range& range) {
+        for (int chunk = range.start; chunk < range.end; ++chunk) {
+            size_t begin = std::min(n, chunk * chunk_size);
+            size_t end = std::min(n, begin + chunk_size);
+            size_t* chunk_counts = &counts[(size_t)chunk * n_shards];
+            for (size_t i = begin; i < end; ++i) {
+                int x, y, z;
+                if (!voxel_coord(points[i].x, inv_size, &x) ||
+                    !voxel_coord(points[i].y, inv_size, &y) ||
+                    !voxel_coord(points[i].z, inv_size, &z)) {
+                    keys[i] = VOXEL_NO_KEY;
+                    continue;
+                }
+                keys[i] = voxel_key(x, y, z);
+                chunk_counts[voxel_hash(keys[i]) % n_shards]++;
+            }
+        }
+    });
+
+    /* Shard-major offsets, so each (chunk, shard) pair owns a disjoint range */
+    std::vector<size_t> offsets((size_t)n_chunks * n_shards);
+    std::vector<size_t> shard_begin(n_shards + 1, 0);
+    size_t total = 0;
+    for (int shard = 0; shard < n_shards; ++shard) {
+        shard_begin[shard] = total;
+        for (int chunk = 0; chunk < n_chunks; ++chunk) {
+            size_t i = (size_t)chunk * n_shards + shard;
+            offsets[i] = total;
+            total += counts[i];
+        }
+    }
+    shard_begin[n_shards] = total;
+
+    /* Pass 2: scatter point indices into their shards, in input order */
+    std::vector<uint32_t> order(total);
+    cv::parallel_for_(cv::Range(0, n_chunks), [&](const cv::Range& range) {
+        for (int chunk = range.start; chunk < range.end; ++chunk) {
+            size_t begin = std::min(n, chunk * chunk_size);
+            size_t end = std::min(n, begin + chunk_size);
+            size_t* chunk_offsets = &offsets[(size_t)chunk * n_shards];
+            for (size_t i = begin; i < end; ++i) {
+                if (keys[i] == VOXEL_NO_KEY) {
+                    continue;
+                }
+                size_t shard = voxel_hash(keys[i]) % n_shards;
+                order[chunk_offsets[shard]++] = static_cast<uint32_t>(i);
+            }
+        }
+    });
+
+    /* Pass 3: every voxel lives in exactly one shard, so shards accumulate
+     * independently
+     */
+    std::vector<std::vector<VoxelAccum>> shard_accums(n_shards);
+    cv::parallel_for_(cv::Range(0, n_shards), [&](const cv::Range& range) {
+        for (int shard = range.start; shard < range.end; ++shard) {
+            accumulate_shard(
+                points,
+                colors,
+                keys,
+                order.data() + shard_begin[shard],
+                shard_begin[shard + 1] - shard_begin[shard],
+                voxel_size,
+                shard_accums[shard]
+            );
+        }
+    });
+
+    /* Pass 4: one output point per voxel */
+    std::vector<size_t> out_begin(n_shards + 1, 0);
+    for (int shard = 0; shard < n_shards; ++shard) {
+        out_begin[shard + 1] = out_begin[shard] + shard_accums[shard].size();
+    }
+    out_points.resize(out_begin[n_shards]);
+    if (out_colors != nullptr) {
+        out_colors->resize(out_begin[n_shards]);
+    }
+    cv::parallel_for_(cv::Range(0, n_shards), [&](const cv::Range& range) {
+        for (int shard = range.start; shard < range.end; ++shard) {
+            const std::vector<VoxelAccum>& accums = shard_accums[shard];
+            for (size_t i = 0; i < accums.size(); ++i) {
+                const VoxelAccum& acc = accums[i];
+                size_t out = out_begin[shard] + i;
+                if (mode == VOXEL_REPRESENTATIVE) {
+                    out_points[out] = points[acc.nearest];
+                    if (out_colors != nullptr) {
+                        (*out_colors)[out] = (*colors)[acc.nearest];
+                    }
+                    continue;
+                }
+                double inv_count = 1.0 / acc.count;
+                out_points[out] = cv::Point3f(
+                    static_cast<float>(acc.sum[0] * inv_count),
+                    static_cast<float>(acc.sum[1] * inv_count),
+                    static_cast<float>(acc.sum[2] * inv_count)
+                );
+                if (out_colors != nullptr) {
+                    uint32_t half = acc.count / 2;
+                    (*out_colors)[out] = cv::Vec3b(
+                        (uint8_t)((acc.color_sum[0] + half) / acc.count),
+                        (uint8_t)((acc.color_sum[1] + half) / acc.count),
+                        (uint8_t)((acc.color_sum[2] + half) / acc.count)
+                    );
+                }
+            }
+        }
+    });
+    return OK;
+}